@@ -7,47 +7,80 @@
 #include <optional>
 #include <future>
 #include <csignal>
+#include <type_traits>
+#include "include/ArenaLCT.hpp"
 #include "include/LCT.hpp"
+#include "include/Stats.hpp"
 #include "include/UnionFind.hpp"
+#include "include/WorkloadFile.hpp"
 
 using namespace std::chrono;
 
 #define DEBUG_BENCHMARK 1
 
-using Workload = std::vector<std::pair<unsigned, unsigned>>;
+// The statistics of `LinkCutTree`, see the CMake option `LCT_STATS`.
+using BenchStats = std::conditional_t<LCT_STATS, CountingStats, NoStats>;
+
 using WorkloadTriple = std::vector<std::tuple<unsigned, unsigned, unsigned>>;
 
-double lookup_benchmark_lct(unsigned n, Workload& workload) {
-  unsigned m = workload.size();
-  std::string name = "LCT";
-  auto checkForCorrectness = [&]() -> void {
-    LinkCutTree lct;
-    std::vector<LinkCutTree::Node*> nodes(n); 
+// Adapts the pointer-based `LinkCutTree` to the index-based API of `ArenaLinkCutTree`.
+// Each vertex is a separately heap-allocated node.
+class PointerLinkCutTree {
+  using Tree = LinkCutTree<NoAggregate, BenchStats>;
+  Tree lct_;
+  std::vector<Tree::Node*> nodes_;
+
+public:
+  explicit PointerLinkCutTree(unsigned n) : nodes_(n) {
     for (unsigned index = 0; index != n; ++index) {
-      nodes[index] = new LinkCutTree::Node();
-      nodes[index]->value = index;
+      nodes_[index] = new Tree::Node();
+      nodes_[index]->value = index;
     }
+  }
+
+  ~PointerLinkCutTree() {
+    for (auto node : nodes_)
+      delete node;
+  }
+
+  void link(unsigned x, unsigned y) { lct_.link(nodes_[x], nodes_[y]); }
+  void cut(unsigned x) { lct_.cut(nodes_[x]); }
+  unsigned findRoot(unsigned x) { return lct_.findRoot(nodes_[x])->value; }
+  bool areConnected(unsigned x, unsigned y) { return lct_.areConnected(nodes_[x], nodes_[y]); }
+};
+
+// Whether the layout counts its operations with `BenchStats`. `ArenaLinkCutTree` is not instrumented.
+template <class TreeType>
+static constexpr bool kInstrumented = std::is_same_v<TreeType, PointerLinkCutTree>;
+
+template <class TreeType>
+double lookup_benchmark_lct(std::string name, unsigned n, const WorkloadFile& workload) {
+  auto checkForCorrectness = [&]() -> void {
+    TreeType lct(n);
     
     UnionFind uf(n);
-    unsigned currIndex = 0;
+    WorkloadReader reader(workload);
     auto read = [&]() -> bool {
-      if (currIndex == workload.size())
+      WorkloadBatch batch;
+      if (!reader.next(batch))
         return false;
-      auto [type, count] = workload[currIndex++];
+      auto type = batch.kind;
+      auto count = batch.ops.size();
+      uint64_t currIndex = 0;
       if (type == 1) {
         while (count--) {
-          auto op = workload[currIndex++];
-          lct.link(nodes[op.first], nodes[op.second]);
+          auto op = batch.ops[currIndex++];
+          lct.link(op.first, op.second);
           uf.unify(op.first, op.second);
-          assert(uf.areConnected(op.first, op.second) == lct.areConnected(nodes[op.first], nodes[op.second]));
+          assert(uf.areConnected(op.first, op.second) == lct.areConnected(op.first, op.second));
         }
       } else {
         while (count--) {
-          auto op = workload[currIndex++];
-          auto root = lct.findRoot(nodes[op.first]);
-          if (root != nodes[op.second])
-            std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root->value << " vs " << nodes[op.second]->value << std::endl;
-          assert(lct.findRoot(nodes[op.first]) == nodes[op.second]);
+          auto op = batch.ops[currIndex++];
+          auto root = lct.findRoot(op.first);
+          if (root != op.second)
+            std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root << " vs " << op.second << std::endl;
+          assert(root == op.second);
         }
       }
       return true;
@@ -60,33 +93,34 @@ double lookup_benchmark_lct(unsigned n, Workload& workload) {
   checkForCorrectness();
 
   auto benchmark = [&]() -> double {
-    LinkCutTree lct;
-    std::vector<LinkCutTree::Node*> nodes(n); 
-    for (unsigned index = 0; index != n; ++index) {
-      nodes[index] = new LinkCutTree::Node();
-      nodes[index]->value = index;
-    }
+    TreeType lct(n);
     
     UnionFind uf(n);
-    unsigned currIndex = 0;
+    WorkloadReader reader(workload);
     auto read = [&]() -> bool {
-      if (currIndex == workload.size())
+      WorkloadBatch batch;
+      if (!reader.next(batch))
         return false;
-      auto [type, count] = workload[currIndex++];
+      auto type = batch.kind;
+      auto count = batch.ops.size();
+      uint64_t currIndex = 0;
       if (type == 1) {
         while (count--) {
-          auto op = workload[currIndex++];
-          lct.link(nodes[op.first], nodes[op.second]);
+          auto op = batch.ops[currIndex++];
+          lct.link(op.first, op.second);
         }
       } else {
         while (count--) {
-          auto op = workload[currIndex++];
-          auto root = lct.findRoot(nodes[op.first]);
+          auto op = batch.ops[currIndex++];
+          auto root = lct.findRoot(op.first);
         }
       }
       return true;
     };
 
+#if LCT_STATS
+    CountingStats::reset();
+#endif
     auto start = high_resolution_clock::now();
     while (read()) {}    
     auto stop = high_resolution_clock::now();
@@ -96,69 +130,57 @@ double lookup_benchmark_lct(unsigned n, Workload& workload) {
 
   auto time = benchmark();
   std::cerr << name << ": " << time << " ms" << std::endl;
+#if LCT_STATS
+  // The counters of the benchmarked run, as JSON on stdout. Uninstrumented layouts would only print zeros.
+  if (kInstrumented<TreeType>)
+    std::cout << "{\"benchmark\": \"" << name << "\", \"time_ms\": " << time << ", \"stats\": " << CountingStats::collect().toJson() << "}" << std::endl;
+  else
+    std::cerr << "No statistics: " << name << " is not instrumented." << std::endl;
+#endif
   return time;
 }
 
-double lookup_benchmark(std::string filename, unsigned n) {
-  Workload workload;
-  std::ifstream input(filename);
-  if (!input.is_open()) {
-    std::cerr << "Workload \"" << filename << "\" could not be loaded. Check its existance!" << std::endl;
-    exit(-1);
-  }
-  
-  std::cerr << "Start loading workload.." << std::endl;
-  auto pos = input.tellg();
-  input.seekg(0, std::ios::end);  
-  auto size = input.tellg() - pos;
-  input.seekg(0, std::ios::beg);
-  unsigned elements = size / sizeof(std::pair<unsigned, unsigned>);
-  workload.resize(elements);
-  input.read(reinterpret_cast<char*>(workload.data()), elements * sizeof(std::pair<unsigned, unsigned>));
-  unsigned m = workload.size();
-
-  return lookup_benchmark_lct(n, workload);
+double lookup_benchmark(const WorkloadFile& workload, unsigned n, bool arena) {
+  return (!arena) ? lookup_benchmark_lct<PointerLinkCutTree>("LCT", n, workload)
+                  : lookup_benchmark_lct<ArenaLinkCutTree>("ArenaLCT", n, workload);
 #if 0
   for (unsigned index = 1; index <= 10; ++index)
     lookup_benchmark_rlct(0.1 * index, n, workload);
 #endif
 }
 
-double cut_benchmark_lct(unsigned n, Workload& workload) {
-  unsigned m = workload.size();
-  std::string name = "LCT";
+template <class TreeType>
+double cut_benchmark_lct(std::string name, unsigned n, const WorkloadFile& workload) {
   auto checkForCorrectness = [&]() -> void {
-    LinkCutTree lct;
-    std::vector<LinkCutTree::Node*> nodes(n); 
-    for (unsigned index = 0; index != n; ++index) {
-      nodes[index] = new LinkCutTree::Node();
-      nodes[index]->value = index;
-    }
+    TreeType lct(n);
     
-    unsigned currIndex = 0;
+    WorkloadReader reader(workload);
     auto read = [&]() -> bool {
-      if (currIndex == workload.size())
+      WorkloadBatch batch;
+      if (!reader.next(batch))
         return false;
-      auto [type, count] = workload[currIndex++];
+      auto type = batch.kind;
+      auto count = batch.ops.size();
+      uint64_t currIndex = 0;
       if (type == 1) {
         while (count--) {
-          auto op = workload[currIndex++];
-          lct.link(nodes[op.first], nodes[op.second]);
-          assert(lct.areConnected(nodes[op.first], nodes[op.second]));
+          auto op = batch.ops[currIndex++];
+          lct.link(op.first, op.second);
+          assert(lct.areConnected(op.first, op.second));
         }
       } else if (type == 2) {
         while (count--) {
-          auto op = workload[currIndex++];
-          lct.cut(nodes[op.first]);
-          assert(!lct.areConnected(nodes[op.first], nodes[op.second]));
+          auto op = batch.ops[currIndex++];
+          lct.cut(op.first);
+          assert(!lct.areConnected(op.first, op.second));
         }
       } else {
         while (count--) {
-          auto op = workload[currIndex++];
-          auto root = lct.findRoot(nodes[op.first]);
-          if (root != nodes[op.second])
-            std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root->value << " vs " << nodes[op.second]->value << std::endl;
-          assert(lct.findRoot(nodes[op.first]) == nodes[op.second]);
+          auto op = batch.ops[currIndex++];
+          auto root = lct.findRoot(op.first);
+          if (root != op.second)
+            std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root << " vs " << op.second << std::endl;
+          assert(root == op.second);
         }
       }
       return true;
@@ -171,37 +193,38 @@ double cut_benchmark_lct(unsigned n, Workload& workload) {
   checkForCorrectness();
 
   auto benchmark = [&]() -> double {
-    LinkCutTree lct;
-    std::vector<LinkCutTree::Node*> nodes(n); 
-    for (unsigned index = 0; index != n; ++index) {
-      nodes[index] = new LinkCutTree::Node();
-      nodes[index]->value = index;
-    }
+    TreeType lct(n);
     
-    unsigned currIndex = 0;
+    WorkloadReader reader(workload);
     auto read = [&]() -> bool {
-      if (currIndex == workload.size())
+      WorkloadBatch batch;
+      if (!reader.next(batch))
         return false;
-      auto [type, count] = workload[currIndex++];
+      auto type = batch.kind;
+      auto count = batch.ops.size();
+      uint64_t currIndex = 0;
       if (type == 1) {
         while (count--) {
-          auto op = workload[currIndex++];
-          lct.link(nodes[op.first], nodes[op.second]);
+          auto op = batch.ops[currIndex++];
+          lct.link(op.first, op.second);
         }
       } else if (type == 2) {
         while (count--) {
-          auto op = workload[currIndex++];
-          lct.cut(nodes[op.first]);
+          auto op = batch.ops[currIndex++];
+          lct.cut(op.first);
         }
       } else {
         while (count--) {
-          auto op = workload[currIndex++];
-          auto root = lct.findRoot(nodes[op.first]);
+          auto op = batch.ops[currIndex++];
+          auto root = lct.findRoot(op.first);
         }
       }
       return true;
     };
 
+#if LCT_STATS
+    CountingStats::reset();
+#endif
     auto start = high_resolution_clock::now();
     while (read()) {}    
     auto stop = high_resolution_clock::now();
@@ -211,73 +234,64 @@ double cut_benchmark_lct(unsigned n, Workload& workload) {
 
   auto time = benchmark();
   std::cerr << name << ": " << time << " ms" << std::endl;
+#if LCT_STATS
+  // The counters of the benchmarked run, as JSON on stdout. Uninstrumented layouts would only print zeros.
+  if (kInstrumented<TreeType>)
+    std::cout << "{\"benchmark\": \"" << name << "\", \"time_ms\": " << time << ", \"stats\": " << CountingStats::collect().toJson() << "}" << std::endl;
+  else
+    std::cerr << "No statistics: " << name << " is not instrumented." << std::endl;
+#endif
   return time;
 }
 
-double cut_benchmark(std::string filename, unsigned n) {
-  Workload workload;
-  std::ifstream input(filename);
-  if (!input.is_open()) {
-    std::cerr << "Workload \"" << filename << "\" could not be loaded. Check its existance!" << std::endl;
-    exit(-1);
-  }
-  
-  std::cerr << "Start loading workload.." << std::endl;
-  auto pos = input.tellg();
-  input.seekg(0, std::ios::end);  
-  auto size = input.tellg() - pos;
-  input.seekg(0, std::ios::beg);
-  unsigned elements = size / sizeof(std::pair<unsigned, unsigned>);
-  workload.resize(elements);
-  input.read(reinterpret_cast<char*>(workload.data()), elements * sizeof(std::pair<unsigned, unsigned>));
-  unsigned m = workload.size();
-
-  std::cerr << "Workload " << filename << ".size()=" << m << std::endl;
-  
-  return cut_benchmark_lct(n, workload);
+double cut_benchmark(const WorkloadFile& workload, unsigned n, bool arena) {
+  return (!arena) ? cut_benchmark_lct<PointerLinkCutTree>("LCT", n, workload)
+                  : cut_benchmark_lct<ArenaLinkCutTree>("ArenaLCT", n, workload);
 }
 
-void benchmark(std::string filename) {
-  // Tokenize.
-  auto tokenize = [&]() -> std::vector<std::string> {
-    auto pos = filename.find_last_of("/");
-    auto tmp = filename.substr(1 + pos, filename.size());
-    std::vector<std::string> tokens;
-    pos = 0;
-    for (std::string delimiter = "-"; (pos = tmp.find(delimiter)) != std::string::npos; tmp.erase(0, pos + 1))
-      tokens.push_back(tmp.substr(0, pos));
-    tokens.push_back(tmp);
-    return std::move(tokens);
-  };
+void benchmark(std::string filename, std::string layout) {
+  // Load the workload. Its parameters are stored in the header.
+  std::cerr << "Start loading workload.." << std::endl;
+  WorkloadFile file(filename);
+  if (!file.isOpen()) {
+    std::cerr << "Workload \"" << filename << "\" " << file.error() << "!" << std::endl;
+    exit(-1);
+  }
+  auto& header = file.header();
+  std::cerr << "Workload " << filename << ": " << header.numBatches << " batches, " << file.bytes() << " bytes" << std::endl;
 
   // Derive parameters and start benchmarking.
-  auto tokens = tokenize();
-  auto workload_type = tokens.front();
-  auto w = tokens[1];
-  auto b = tokens[tokens.size() - 2];
-  auto n = atoi(tokens.back().substr(0, tokens.back().find_last_of(".")).data());
-  std::cerr << "Start benchmarking \"" << workload_type << "(" << std::to_string(n) << ")\"" << std::endl;
+  std::string workload_type = workloadKindName(header.kind);
+  auto w = header.arity ? std::to_string(header.arity) : "random";
+  auto b = std::to_string(header.batchSize);
+  unsigned n = file.n();
+  if ((layout != "pointer") && (layout != "arena")) {
+    std::cerr << "Layout \"" << layout << "\" not yet supported!" << std::endl;
+    exit(-1);
+  }
+  auto arena = (layout == "arena");
+  std::cerr << "Start benchmarking \"" << workload_type << "(" << std::to_string(n) << ")\" with layout \"" << layout << "\"" << std::endl;
   double time = 0;
   if (workload_type == "lookup") {
-    time = lookup_benchmark(filename, n);  
+    time = lookup_benchmark(file, n, arena);  
   } else if (workload_type == "cut") {
-    time = cut_benchmark(filename, n);  
+    time = cut_benchmark(file, n, arena);  
   } else {
     std::cerr << "Workload \"" << workload_type << "\" not yet supported!" << std::endl;
     exit(-1);
   }
 
-  std::ofstream log("../logs/" + workload_type + "-p_0" + "-w_" + w + "-b_" + b + "-n_" + std::to_string(n) + ".log");
+  std::ofstream log("../logs/" + workload_type + "-p_0" + "-w_" + w + "-b_" + b + "-n_" + std::to_string(n) + (arena ? "-arena" : "") + ".log");
   log << time << " ms" << std::endl;
 }
 
 int main(int argc, char** argv) {
-  if (argc < 2) {
-    std::cerr << "Usage: " << argv[0] << " <workload:file>" << std::endl;
+  if ((argc != 2) && (argc != 3)) {
+    std::cerr << "Usage: " << argv[0] << " <workload:file> [<layout:string[pointer,arena]>]" << std::endl;
     exit(-1);
   }
 
   // Benchmark.
-  benchmark(argv[1]);
+  benchmark(argv[1], (argc == 3) ? argv[2] : "pointer");
   return 0;
 }
@@ -8,15 +8,23 @@
 #include <optional>
 #include <limits>
 #include <cstdlib>
-#include <unordered_set>
-#include "include/LCT.hpp"
+#include <cassert>
+#include <array>
+#include <cstdio>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "include/RelaxedAtomic.hpp"
 #include "include/UnionFind.hpp"
+#include "include/WorkerPool.hpp"
+#include "include/WorkloadFile.hpp"
 
 using namespace std::chrono;
 static constexpr unsigned infty = std::numeric_limits<unsigned>::max();
 using Pair = std::pair<unsigned, unsigned>;
 using Triple = std::tuple<unsigned, unsigned, unsigned>;
-using Workload = std::vector<Pair>;
 
 template<class Generator>
 std::vector<unsigned> sample(std::vector<unsigned>& list, unsigned capacity, Generator& engine) {
@@ -36,115 +44,309 @@ std::vector<unsigned> sample(std::vector<unsigned>& list, unsigned capacity, Gen
 
 static uint64_t randomState = 123;
 
-std::vector<Pair> buildEdges(unsigned n, std::vector<unsigned>& tree) {
-  std::vector<Pair> edges;
-  for (unsigned index = 0; index != n; ++index) {
-    if (index == tree[index]) continue;
-    edges.push_back({index, tree[index]});
+// The parent of each node in the forest generated so far, or `kNoParent` for the roots.
+// The roots of the lookups are computed in parallel. In the lookup workload, the climbs also compress the paths, since links never invalidate an ancestor.
+// Concurrent compressions only store ancestors, hence the entries are relaxed atomics.
+static constexpr unsigned kNoParent = infty;
+using ParentArray = std::vector<RelaxedAtomic<unsigned>>;
+
+// A batch of the workload.
+struct Batch {
+  OpKind kind;
+  std::vector<Pair> ops;
+};
+
+// Receives the batches in the order they are generated.
+using BatchSink = std::function<void(OpKind, std::vector<Pair>)>;
+
+// Hands the batches of the generator to a consumer thread, e.g., the writer or the oracle.
+// The queue is bounded, so that only a few batches are in memory at any time.
+class BatchStage {
+public:
+  template <class Consumer>
+  explicit BatchStage(Consumer consumer)
+  // The constructor. `consumer(batch)` is called on the thread of the stage, for each batch in order.
+  : thread_([this, consumer]() mutable {
+      while (auto batch = pop())
+        consumer(*batch);
+    }) {}
+
+  ~BatchStage()
+  // The destructor.
+  {
+    finish();
   }
-  return edges;
+
+  BatchStage(const BatchStage&) = delete;
+  BatchStage& operator=(const BatchStage&) = delete;
+
+  void push(std::shared_ptr<const Batch> batch) {
+  // Enqueue `batch`. Blocks while the queue is full. A null `batch` ends the stage.
+    std::unique_lock lock(mutex_);
+    notFull_.wait(lock, [&]() { return queue_.size() < kCapacity; });
+    queue_.push_back(std::move(batch));
+    notEmpty_.notify_one();
+  }
+
+  void finish() {
+  // Wait until all batches are consumed.
+    if (!thread_.joinable())
+      return;
+    push(nullptr);
+    thread_.join();
+  }
+
+private:
+  // The maximum number of queued batches.
+  static constexpr unsigned kCapacity = 4;
+
+  std::mutex mutex_;
+  std::condition_variable notFull_, notEmpty_;
+  std::deque<std::shared_ptr<const Batch>> queue_;
+  // The consumer thread. It is the last member, so that the queue exists before it starts.
+  std::thread thread_;
+
+  std::shared_ptr<const Batch> pop() {
+    std::unique_lock lock(mutex_);
+    notEmpty_.wait(lock, [&]() { return !queue_.empty(); });
+    auto batch = std::move(queue_.front());
+    queue_.pop_front();
+    notFull_.notify_one();
+    return batch;
+  }
+};
+
+// Checks the batches as they are generated, without replaying them on a link-cut tree.
+// Without cuts, the trees only grow. Thus, a `UnionFind` whose sets carry the root of their tree answers each lookup in O(α(n)).
+// With cuts, the oracle keeps its own parent array, rebuilt from the batches only, and climbs it.
+// In both cases, links must attach a root to another tree and cuts must remove an existing edge.
+// The operations of a mixed batch may run in any order. Hence, its lookups are checked before and after its updates, its cuts against
+// the forest at the beginning of the batch, and its links before its cuts, i.e., when the forest is the most connected.
+class Oracle {
+public:
+  Oracle(unsigned n, bool withCuts)
+  // The constructor.
+  : withCuts_(withCuts), parent_(n, kNoParent), uf_(withCuts ? 0 : n), treeRoot_(withCuts ? 0 : n)
+  {
+    for (unsigned index = 0; index != treeRoot_.size(); ++index)
+      treeRoot_[index] = index;
+  }
+
+  void operator()(const Batch& batch) {
+  // Check `batch` and apply it.
+    if (batch.kind == kMixed) {
+      checkMixed(batch);
+      return;
+    }
+    for (auto [u, v] : batch.ops)
+      apply(batch.kind, u, v);
+  }
+
+  // Whether an operation was invalid or a lookup did not match.
+  bool failed() const { return failed_; }
+
+private:
+  bool withCuts_;
+  bool failed_ = false;
+  std::vector<unsigned> parent_;
+  UnionFind uf_;
+  // The root of the tree of each set of `uf_`, stored at its representative.
+  std::vector<unsigned> treeRoot_;
+
+  unsigned rootOf(unsigned x) {
+    if (!withCuts_)
+      return treeRoot_[uf_.find(x)];
+    while (parent_[x] != kNoParent)
+      x = parent_[x];
+    return x;
+  }
+
+  void apply(OpKind kind, unsigned u, unsigned v) {
+  // Check a single operation and apply it.
+    if (kind == kLink) {
+      if ((parent_[u] != kNoParent) || (rootOf(v) == u))
+        report("link", u, v, rootOf(u));
+      parent_[u] = v;
+      if (!withCuts_) {
+        auto root = treeRoot_[uf_.find(v)];
+        uf_.unify(u, v);
+        treeRoot_[uf_.find(u)] = root;
+      }
+    } else if (kind == kCut) {
+      if (parent_[u] != v)
+        report("cut", u, v, parent_[u]);
+      parent_[u] = kNoParent;
+    } else if (kind == kLookup) {
+      if (rootOf(u) != v)
+        report("lookup", u, v, rootOf(u));
+    } else {
+      report("operation", u, v, kind);
+    }
+  }
+
+  void checkMixed(const Batch& batch) {
+    auto forEach = [&](OpKind kind, auto&& function) {
+      for (auto [u, v] : batch.ops)
+        if (MixedOp::kind(u) == kind)
+          function(MixedOp::label(u), v);
+    };
+    auto lookups = [&]() { forEach(kLookup, [&](unsigned u, unsigned v) { apply(kLookup, u, v); }); };
+    lookups();
+    forEach(kCut, [&](unsigned u, unsigned v) {
+      if (parent_[u] != v)
+        report("cut", u, v, parent_[u]);
+    });
+    forEach(kLink, [&](unsigned u, unsigned v) { apply(kLink, u, v); });
+    forEach(kCut, [&](unsigned u, unsigned v) { apply(kCut, u, v); });
+    forEach(kMixed, [&](unsigned u, unsigned v) { apply(kMixed, u, v); });
+    lookups();
+  }
+
+  void report(const char* kind, unsigned u, unsigned v, unsigned actual) {
+    std::cerr << kind << "=(" << u << "," << v << ") is invalid, found " << actual << std::endl;
+    failed_ = true;
+  }
+};
+
+template <class Function>
+void parallelFor(WorkerPool& pool, uint64_t lb, uint64_t ub, Function&& function) {
+  // Run `function(index)` for all indices in [lb, ub), in one contiguous chunk per worker.
+  uint64_t chunk = (ub - lb + pool.size() - 1) / pool.size();
+  pool.run([&](unsigned workerId) {
+    for (uint64_t index = lb + workerId * chunk, limit = std::min(ub, index + chunk); index < limit; ++index)
+      function(index);
+  });
 }
 
-std::vector<Pair> buildRandomTree(unsigned n, unsigned batch_size) {
-  auto nextRandom = [&]() {
-    uint64_t x=randomState;
-    x = x ^ (x >> 12);
-    x = x ^ (x << 25);
-    x = x ^ (x >> 27);
-    randomState = x;
-    return x * 0x2545F4914F6CDD1Dull;
-  };
-  
-  auto randomInt = [&](unsigned lower, unsigned upper) {
-    return (upper <= lower) ? lower : (lower + (nextRandom() % (upper - lower + 1)));
-  };
-  
-  std::vector<unsigned> tree(n);
-  for (unsigned index = 1; index != n; ++index) {
-    tree[index] = randomInt(0, index - 1);
+static uint64_t nextRandom(uint64_t& state) {
+  // The xorshift64* generator.
+  uint64_t x = state;
+  x = x ^ (x >> 12);
+  x = x ^ (x << 25);
+  x = x ^ (x >> 27);
+  state = x;
+  return x * 0x2545F4914F6CDD1Dull;
+}
+
+std::vector<Pair> buildRandomTree(unsigned n, unsigned batch_size, WorkerPool& pool) {
+  // Node `index` >= 2 takes the (index - 1)-th random number modulo `index` as its parent, node 1 takes 0.
+  // The generator is sequential, thus its states at the chunk boundaries are computed first. The chunks then run in parallel.
+  uint64_t chunk = (n + pool.size() - 1) / pool.size();
+  std::vector<uint64_t> states(pool.size(), randomState);
+  for (unsigned index = 2; index < n; ++index) {
+    if (index % chunk == 0)
+      states[index / chunk] = randomState;
+    nextRandom(randomState);
   }
-  return buildEdges(n, tree);
+
+  std::vector<Pair> edges(n ? n - 1 : 0);
+  pool.run([&](unsigned workerId) {
+    uint64_t state = states[workerId];
+    for (uint64_t index = std::max<uint64_t>(workerId * chunk, 1), limit = std::min<uint64_t>(n, (workerId + 1) * chunk); index < limit; ++index)
+      edges[index - 1] = {index, (index == 1) ? 0 : nextRandom(state) % index};
+  });
+  return edges;
 }
 
-std::vector<Pair> buildKAryTree(unsigned n, std::string tree_type, unsigned batch_size) {
+std::vector<Pair> buildKAryTree(unsigned n, std::string tree_type, unsigned batch_size, WorkerPool& pool) {
   auto k = atoi(tree_type.substr(0, tree_type.find("-")).data());
   std::cerr << "Build " << tree_type << " tree of " << n << " nodes!" << std::endl;
-  std::vector<unsigned> tree(n);
-  for (unsigned index = 0; index != n; ++index) {
-    if (!index) continue;
-    tree[index] = (index - 1) / k;
+  std::vector<Pair> edges(n ? n - 1 : 0);
+  parallelFor(pool, 1, n, [&](uint64_t index) {
+    edges[index - 1] = {index, (index - 1) / k};
+  });
+  return edges;
+}
+
+unsigned climb(ParentArray& parent, unsigned x, bool compress) {
+  // The root of `x`. If `compress` is set, the nodes on the way are linked to the root.
+  unsigned root = x;
+  while (parent[root] != kNoParent)
+    root = parent[root];
+  while (compress && (x != root)) {
+    unsigned next = parent[x];
+    parent[x] = root;
+    x = next;
   }
-  return buildEdges(n, tree);
+  return root;
 }
 
-Workload buildLookupWorkload(unsigned n, std::vector<Pair> edges, unsigned batch_size) {
-  std::vector<std::optional<unsigned>> parent(n);
-  auto debug = [&](std::optional<unsigned> x) -> std::string {
-    return (x.has_value() ? std::to_string(x.value()) : "none");
-  };
+// The nodes touched since the last batch of lookups, ordered by the operation which touched them last.
+// The touches are logged in the order of the operations, so the log needs no sorting. A node touched again moves to the back: `slot_` maps it
+// to its latest entry, and older entries are skipped. As a sparse set, `slot_` is never reset, an entry is only trusted if it points back.
+// Thus, a batch costs O(β) instead of sorting and resetting all n nodes.
+class WorkingSet {
+public:
+  explicit WorkingSet(unsigned n)
+  // The constructor.
+  : slot_(n) {}
 
-  UnionFind uf(n);
-  std::function<unsigned(unsigned)> climb = [&](unsigned x) -> unsigned {
-    if (!parent[x].has_value()) return x;
-    auto val = climb(parent[x].value());
-    parent[x] = val;
-    return val;
-  };
+  void touch(unsigned node) {
+  // Record that the current operation touched `node`.
+    slot_[node] = touched_.size();
+    touched_.push_back(node);
+  }
 
-  std::function<bool(unsigned&, unsigned&)> preprocess = [&](unsigned &u, unsigned &v) -> bool {
-    if (!parent[u]) return true;
-    if (!parent[v]) {
-      std::swap(u, v);
-      return true;
+  template <class Function>
+  void forEach(unsigned limit, Function&& function) {
+  // Call `function(node)` for the first `limit` distinct nodes, by the operation which touched them last, and clear the set.
+    for (unsigned index = 0, count = 0, size = touched_.size(); (index != size) && (count != limit); ++index) {
+      unsigned node = touched_[index];
+      if (slot_[node] != index)
+        continue;
+      function(node);
+      ++count;
     }
-    u = climb(u);
-    v = climb(v);
-    return true;
-  };
+    touched_.clear();
+  }
+
+private:
+  // The latest entry of each node in `touched_`.
+  std::vector<unsigned> slot_;
+  // The log of the touches.
+  std::vector<unsigned> touched_;
+};
+
+std::vector<Pair> buildLookups(WorkingSet& workingSet, unsigned barrier, ParentArray& parent, bool compress, WorkerPool& pool) {
+  // The lookups of a batch: the first `barrier` nodes of the working set, by the operation which touched them, with their roots.
+  std::vector<Pair> lookups;
+  workingSet.forEach(barrier, [&](unsigned node) {
+    lookups.push_back(std::make_pair(node, node));
+  });
+  parallelFor(pool, 0, lookups.size(), [&](uint64_t index) {
+    lookups[index].second = climb(parent, lookups[index].first, compress);
+  });
+  return lookups;
+}
+
+void buildLookupWorkload(unsigned n, const std::vector<Pair>& edges, unsigned batch_size, WorkerPool& pool, const BatchSink& emit) {
+  ParentArray parent(n, kNoParent);
 
   std::cerr << "Start building workload.." << std::endl;
   unsigned barrier = batch_size;
-  std::vector<Pair> workload, inserts, workingSet;
-  workingSet.assign(n, {infty, 0});
-  
+  std::vector<Pair> inserts;
+  WorkingSet workingSet(n);
+
   auto complete = [&]() -> void {
     if (inserts.size() <= 1)
       return;
-    workload.push_back(std::make_pair(1, inserts.size()));
-    workload.insert(workload.end(), inserts.begin(), inserts.end());
-    
-    std::sort(workingSet.begin(), workingSet.end(), [&](auto lhs, auto rhs) {
-      return lhs.first < rhs.first;
-    });
-    
-    std::vector<Pair> lookups;
-    std::unordered_set<unsigned> already;
-    for (unsigned index = 0, limit = workingSet.size(), minLimit = std::min(barrier, limit); (index != minLimit) && (workingSet[index].first != infty); ++index) {
-      auto [_, node] = workingSet[index];
-      if (already.find(node) != already.end())
-        continue;
-      lookups.push_back(std::make_pair(node, parent[node].has_value() ? climb(parent[node].value()) : node));
-      already.insert(node);
-    }
-    workload.push_back(std::make_pair(0, lookups.size()));
-    workload.insert(workload.end(), lookups.begin(), lookups.end());
-    workingSet.assign(n, {infty, 0});
+    emit(kLink, std::move(inserts));
     inserts.clear();
+    emit(kLookup, buildLookups(workingSet, barrier, parent, true, pool));
   };
-  
+
   unsigned m = edges.size();
   for (unsigned index = 0; index != m; ++index) {
 #if 1
     if (index % 1024 == 0) std::cerr << "Checkpoint: index=" << index << std::endl;
 #endif
     unsigned u = edges[index].first, v = edges[index].second;
-    
-    workingSet[u] = {index, u};
-    workingSet[v] = {index, v};
+
+    workingSet.touch(u);
+    workingSet.touch(v);
     inserts.push_back(std::make_pair(u, v));
     parent[u] = v;
-    uf.unify(u, v);
-    
+
     if ((index) && (index % barrier == 0)) {
       complete();
     }
@@ -152,143 +354,52 @@ Workload buildLookupWorkload(unsigned n, std::vector<Pair> edges, unsigned batch
   if (!inserts.empty()) {
     complete();
   }
-  m = workload.size();
-  
-  auto checkForCorrectness = [&]() -> void {
-    LinkCutTree lct;
-    std::vector<LinkCutTree::Node*> nodes(n); 
-    for (unsigned index = 0; index != n; ++index) {
-      nodes[index] = new LinkCutTree::Node();
-      nodes[index]->value = index;
-    }
-    
-    UnionFind uf(n);
-    unsigned currIndex = 0;
-    auto read = [&]() -> bool {
-      if (currIndex == workload.size())
-        return false;
-      auto [type, count] = workload[currIndex++];
-      if (type == 1) {
-        while (count--) {
-          auto op = workload[currIndex++];
-          lct.link(nodes[op.first], nodes[op.second]);
-          uf.unify(op.first, op.second);
-          assert(uf.areConnected(op.first, op.second) == lct.areConnected(nodes[op.first], nodes[op.second]));
-        }
-      } else {
-        while (count--) {
-          auto op = workload[currIndex++];
-          auto root = lct.findRoot(nodes[op.first]);
-          if (root != nodes[op.second])
-            std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root->value << " vs " << nodes[op.second]->value << std::endl;
-          assert(lct.findRoot(nodes[op.first]) == nodes[op.second]);
-        }
-      }
-      return true;
-    };
-    
-    while (read()) {}
-  };
-
-  std::cerr << "Check for correctness.." << std::endl;
-  checkForCorrectness();
-  return std::move(workload);
 }
 
-Workload buildCutWorkload(unsigned n, std::vector<Pair> edges, unsigned batch_size) {
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_int_distribution<> distrib(0, n - 1);
-  std::vector<std::optional<unsigned>> parent(n);
-
-  auto debug = [&](std::optional<unsigned> x) -> std::string {
-    return (x.has_value() ? std::to_string(x.value()) : "none");
-  };
-
-  std::function<unsigned(unsigned)> climb = [&](unsigned x) -> unsigned {
-    if (!parent[x].has_value()) return x;
-    auto val = climb(parent[x].value());
-    return val;
-  };
-
-  std::function<bool(unsigned&, unsigned&)> preprocess = [&](unsigned &u, unsigned &v) -> bool {
-    if (!parent[u]) return true;
-    if (!parent[v]) {
-      std::swap(u, v);
-      return true;
-    }
-    u = climb(u);
-    v = climb(v);
-    return true;
-  };
+void buildCutWorkload(unsigned n, const std::vector<Pair>& edges, unsigned batch_size, WorkerPool& pool, const BatchSink& emit) {
+  ParentArray parent(n, kNoParent);
 
   // std::cerr << "Start building workload.." << std::endl;
   unsigned barrier = batch_size;
-  std::vector<Pair> workload, inserts, workingSet, persistent;
-  unsigned buffPtr = 0;
-  std::vector<bool> taken;
-  workingSet.assign(n, {infty, 0});
-  
+  std::vector<Pair> inserts;
+  WorkingSet workingSet(n);
+  // The next edge to cut, and the number of edges linked so far. The edges are cut in the order they were linked.
+  unsigned buffPtr = 0, linked = 0;
+
   auto complete = [&]() -> void {
     if (inserts.size() <= 1)
       return;
-    auto processWorkingSet = [&]() -> void {
-      std::sort(workingSet.begin(), workingSet.end(), [&](auto lhs, auto rhs) {
-        return lhs.first < rhs.first;
-      });
-      
-      std::vector<Pair> lookups;
-      std::unordered_set<unsigned> already;
-      for (unsigned index = 0, limit = workingSet.size(), minLimit = std::min(barrier, limit); (index != minLimit) && (workingSet[index].first != infty); ++index) {
-        auto [_, node] = workingSet[index];
-        if (already.find(node) != already.end())
-          continue;
-        lookups.push_back(std::make_pair(node, parent[node].has_value() ? climb(parent[node].value()) : node));
-        already.insert(node);
-      }
-      workload.push_back(std::make_pair(0, lookups.size()));
-      workload.insert(workload.end(), lookups.begin(), lookups.end());
-      workingSet.assign(n, {infty, 0});
-    };
-    
-    workload.push_back(std::make_pair(1, inserts.size()));
-    workload.insert(workload.end(), inserts.begin(), inserts.end());
-    processWorkingSet();
+    emit(kLink, std::move(inserts));
     inserts.clear();
-    
+    emit(kLookup, buildLookups(workingSet, barrier, parent, false, pool));
+
     std::vector<Pair> cuts;
     unsigned cnt = 0, limCut = barrier;
-    while (buffPtr != persistent.size()) {
-      if (taken[buffPtr]) continue;
+    while (buffPtr != linked) {
       ++cnt;
       if (cnt == limCut) break;
-      cuts.push_back(persistent[buffPtr]);
-      taken[buffPtr] = true;
-      auto [u, v] = persistent[buffPtr];
-      parent[u] = std::nullopt;
-      workingSet[u] = {buffPtr, u};
-      workingSet[v] = {buffPtr, v};
+      cuts.push_back(edges[buffPtr]);
+      auto [u, v] = edges[buffPtr];
+      parent[u] = kNoParent;
+      workingSet.touch(u);
+      workingSet.touch(v);
       ++buffPtr;
-    }    
-    workload.push_back(std::make_pair(2, cuts.size()));
-    workload.insert(workload.end(), cuts.begin(), cuts.end());
-    processWorkingSet();
+    }
+    emit(kCut, std::move(cuts));
+    emit(kLookup, buildLookups(workingSet, barrier, parent, false, pool));
   };
-  
-  UnionFind uf(n);
+
   for (unsigned index = 0, limit = edges.size(); index != limit; ++index) {
 #if 1
     if (index % 1024 == 0) std::cerr << "Checkpoint: index=" << index << std::endl;
 #endif
     unsigned u = edges[index].first, v = edges[index].second;
-    uf.unify(u, v);
-    workingSet[u] = {index, u};
-    workingSet[v] = {index, v};
+    workingSet.touch(u);
+    workingSet.touch(v);
     inserts.push_back(std::make_pair(u, v));
-    persistent.push_back(std::make_pair(u, v));
-    taken.push_back(false);
+    ++linked;
     parent[u] = v;
-    
+
     if ((index) && (index % barrier == 0)) {
       std::cerr << "index=" << index << " complete!" << std::endl;
       complete();
@@ -297,98 +408,234 @@ Workload buildCutWorkload(unsigned n, std::vector<Pair> edges, unsigned batch_si
   if (!inserts.empty()) {
     complete();
   }
-  unsigned m = workload.size();
-  
-#if 0
-  std::cerr << "m=" << m << std::endl;
-  if (m <= 150) {
-    for (auto elem: workload) {
-      std::cerr << elem.first << "," << elem.second << std::endl;
+}
+
+// A set of nodes with constant-time insertion, removal and sampling: a dense array, and the position of each node in it.
+class NodeSet {
+public:
+  explicit NodeSet(unsigned n)
+  // The constructor.
+  : position_(n, kNoParent) {}
+
+  unsigned size() const { return dense_.size(); }
+
+  bool contains(unsigned node) const { return position_[node] != kNoParent; }
+
+  void clear() {
+    for (auto node : dense_)
+      position_[node] = kNoParent;
+    dense_.clear();
+  }
+
+  void insert(unsigned node) {
+    position_[node] = dense_.size();
+    dense_.push_back(node);
+  }
+
+  void erase(unsigned node) {
+    auto last = dense_.back();
+    dense_[position_[node]] = last;
+    position_[last] = position_[node];
+    dense_.pop_back();
+    position_[node] = kNoParent;
+  }
+
+  template <class Generator>
+  std::vector<unsigned> sample(unsigned count, Generator& engine) {
+  // Draw `count` distinct nodes, or all of them if there are fewer (partial Fisher-Yates shuffle).
+    count = std::min(count, size());
+    for (unsigned index = 0; index != count; ++index) {
+      unsigned other = std::uniform_int_distribution<unsigned>{index, size() - 1}(engine);
+      std::swap(dense_[index], dense_[other]);
+      position_[dense_[index]] = index;
+      position_[dense_[other]] = other;
     }
+    return std::vector<unsigned>(dense_.begin(), dense_.begin() + count);
   }
-#endif
 
-  auto checkForCorrectness = [&]() -> void {
-    LinkCutTree lct;
-    std::vector<LinkCutTree::Node*> nodes(n); 
-    for (unsigned index = 0; index != n; ++index) {
-      nodes[index] = new LinkCutTree::Node();
-      nodes[index]->value = index;
+private:
+  std::vector<unsigned> position_;
+  std::vector<unsigned> dense_;
+};
+
+void buildMixedWorkload(unsigned n, const std::vector<Pair>& edges, unsigned batch_size, const std::array<unsigned, 3>& mix, std::mt19937_64& engine, WorkerPool& pool, const BatchSink& emit) {
+  // The first half of the edges is linked as in the other workloads. Then, each batch mixes lookups, links and cuts in the ratio `mix`.
+  // The links re-add and the cuts remove edges of the generated tree. Thus, every batch is valid in any order:
+  // - A link attaches a root `u` to its parent in the tree. The forest stays a subgraph of the tree, so no link closes a cycle.
+  //   Only this link gives `u` a parent.
+  // - A cut removes an edge which exists at the beginning of the batch, and no link of the batch adds it back.
+  // - A lookup targets a tree which no update of the batch touches, so its root is the one at the beginning of the batch.
+  static constexpr unsigned kLookupRounds = 4;
+  std::vector<unsigned> treeParent(n, kNoParent);
+  for (auto [u, v] : edges)
+    treeParent[u] = v;
+  ParentArray parent(n, kNoParent);
+  NodeSet present(n), missing(n);
+
+  unsigned initial = edges.size() / 2;
+  for (unsigned index = 0; index < initial; index += batch_size) {
+    std::vector<Pair> links(edges.begin() + index, edges.begin() + std::min(initial, index + batch_size));
+    for (auto [u, v] : links) {
+      parent[u] = v;
+      present.insert(u);
     }
-    
-    unsigned currIndex = 0;
-    auto read = [&]() -> bool {
-      if (currIndex == workload.size())
-        return false;
-      auto [type, count] = workload[currIndex++];
-      if (type == 1) {
-        while (count--) {
-          auto op = workload[currIndex++];
-          lct.link(nodes[op.first], nodes[op.second]);
-          assert(lct.areConnected(nodes[op.first], nodes[op.second]));
-        }
-      } else if (type == 2) {
-        while (count--) {
-          auto [u, v] = workload[currIndex++];
-          lct.cut(nodes[u]);
-          assert(!lct.areConnected(nodes[u], nodes[v]));
-        }
-      } else {
-        while (count--) {
-          auto op = workload[currIndex++];
-          auto root = lct.findRoot(nodes[op.first]);
-          if (root != nodes[op.second])
-            std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root->value << " vs " << nodes[op.second]->value << std::endl;
-          assert(lct.findRoot(nodes[op.first]) == nodes[op.second]);
-        }
-      }
-      return true;
-    };
-    
-    while (read()) {}
-  };
+    emit(kLink, std::move(links));
+  }
+  for (unsigned index = initial, limit = edges.size(); index != limit; ++index)
+    missing.insert(edges[index].first);
+
+  // As many mixed batches as link batches.
+  std::uniform_int_distribution<unsigned> anyNode(0, n - 1);
+  unsigned total = mix[0] + mix[1] + mix[2];
+  unsigned numBatches = std::max(1u, (initial + batch_size - 1) / batch_size);
+  NodeSet touched(n);
+  for (unsigned batch = 0; batch != numBatches; ++batch) {
+    auto cuts = present.sample(static_cast<uint64_t>(batch_size) * mix[2] / total, engine);
+    auto links = missing.sample(static_cast<uint64_t>(batch_size) * mix[1] / total, engine);
+    unsigned numLookups = static_cast<uint64_t>(batch_size) * mix[0] / total;
+
+    // The trees touched by the updates, by their roots.
+    std::vector<unsigned> updated(cuts);
+    for (auto u : links)
+      updated.push_back(treeParent[u]);
+    parallelFor(pool, 0, updated.size(), [&](uint64_t index) {
+      updated[index] = climb(parent, updated[index], false);
+    });
+    touched.clear();
+    for (auto root : updated)
+      if (!touched.contains(root))
+        touched.insert(root);
+    for (auto u : links)
+      if (!touched.contains(u))
+        touched.insert(u);
 
-  std::cerr << "Check for correctness.." << std::endl;
-  checkForCorrectness();
-  return std::move(workload);
+    // Draw the lookups from the untouched trees. If most nodes are in touched trees, the batch has fewer lookups.
+    std::vector<Pair> ops;
+    for (unsigned round = 0; (round != kLookupRounds) && (ops.size() != numLookups); ++round) {
+      std::vector<Pair> candidates(numLookups - ops.size());
+      for (auto& candidate : candidates)
+        candidate.first = anyNode(engine);
+      parallelFor(pool, 0, candidates.size(), [&](uint64_t index) {
+        candidates[index].second = climb(parent, candidates[index].first, false);
+      });
+      for (auto [u, root] : candidates)
+        if (!touched.contains(root))
+          ops.push_back({MixedOp::encode(kLookup, u), root});
+    }
+
+    // Apply the updates.
+    for (auto u : cuts) {
+      ops.push_back({MixedOp::encode(kCut, u), treeParent[u]});
+      parent[u] = kNoParent;
+      present.erase(u);
+      missing.insert(u);
+    }
+    for (auto u : links) {
+      ops.push_back({MixedOp::encode(kLink, u), treeParent[u]});
+      parent[u] = treeParent[u];
+      missing.erase(u);
+      present.insert(u);
+    }
+    std::shuffle(ops.begin(), ops.end(), engine);
+    emit(kMixed, std::move(ops));
+  }
 }
 
-void buildConcurrentWorkload(unsigned n, std::string tree_type, std::string workload_type, unsigned batch_size) {
+void buildConcurrentWorkload(unsigned n, std::string tree_type, std::string workload_type, unsigned batch_size, uint64_t seed, WorkloadEncoding encoding, const std::array<unsigned, 3>& mix) {
+  if ((workload_type != "lookup") && (workload_type != "cut") && (workload_type != "mixed")) {
+    std::cerr << "Workload \"" << workload_type << "\" not yet supported!" << std::endl;
+    exit(-1);
+  }
+  if ((workload_type == "mixed") && (n > MixedOp::kMaxLabel)) {
+    std::cerr << "Mixed workloads support at most " << MixedOp::kMaxLabel << " nodes!" << std::endl;
+    exit(-1);
+  }
+  WorkerPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+  randomState = seed;
   std::vector<Pair> edges;
   if (tree_type == "random") {
-    edges = buildRandomTree(n, batch_size);
+    edges = buildRandomTree(n, batch_size, pool);
   } else {
-    edges = buildKAryTree(n, tree_type, batch_size);
+    edges = buildKAryTree(n, tree_type, batch_size, pool);
   }
   assert(!edges.empty());
   
-  // Shuffle the edges.
-  std::random_shuffle(edges.begin(), edges.end());
+  // Shuffle the edges. This stays sequential, so that a seed always yields the same workload.
+  std::mt19937_64 engine(seed);
+  std::shuffle(edges.begin(), edges.end(), engine);
 
-  // Take only half of the edges.
-  edges.resize(static_cast<unsigned>(0.5 * edges.size()));
-  
-  // Build the workload.
-  Workload workload;
-  if (workload_type == "lookup") {
-    workload = buildLookupWorkload(n, edges, batch_size);
-  } else if (workload_type == "cut") {
-    workload = buildCutWorkload(n, edges, batch_size);
-  } else {
-    std::cerr << "Workload \"" << workload_type << "\" not yet supported!" << std::endl;
+  // Take only half of the edges. The mixed workload keeps the others for its links.
+  if (workload_type != "mixed") {
+    edges.resize(static_cast<unsigned>(0.5 * edges.size()));
+    edges.shrink_to_fit();
+  }
+
+  // The header describes the workload, the file name is only for convenience.
+  WorkloadHeader header;
+  header.n = n;
+  header.kind = (workload_type == "lookup") ? kLookupWorkload : ((workload_type == "cut") ? kCutWorkload : kMixedWorkload);
+  header.batchSize = batch_size;
+  header.arity = (tree_type == "random") ? 0 : atoi(tree_type.substr(0, tree_type.find("-")).data());
+  header.seed = seed;
+  header.encoding = encoding;
+  if (workload_type == "mixed") {
+    for (unsigned index = 0; index != 3; ++index)
+      header.mix[index] = mix[index];
+    workload_type += "-" + std::to_string(mix[0]) + "-" + std::to_string(mix[1]) + "-" + std::to_string(mix[2]);
+  }
+  auto filename = "../workloads/" + workload_type + "-" + tree_type + "-" + std::to_string(batch_size) + "-" + std::to_string(n) + ".bin";
+  WorkloadWriter writer(filename, header);
+  if (!writer.isOpen()) {
+    std::cerr << "Workload \"" << filename << "\" could not be written!" << std::endl;
+    exit(-1);
+  }
+
+  // Build the workload. The batches are written and checked by the oracle on two further threads, while the next ones are generated.
+  // The header is only written by `finish`, so that a file which fails the check is rejected by the benchmarks.
+  Oracle oracle(n, header.kind != kLookupWorkload);
+  {
+    BatchStage writing([&](const Batch& batch) { writer.append(batch.kind, batch.ops.data(), batch.ops.size()); });
+    BatchStage checking([&](const Batch& batch) { oracle(batch); });
+    BatchSink emit = [&](OpKind kind, std::vector<Pair> ops) {
+      auto batch = std::make_shared<const Batch>(Batch{kind, std::move(ops)});
+      writing.push(batch);
+      checking.push(batch);
+    };
+    if (header.kind == kLookupWorkload) {
+      buildLookupWorkload(n, edges, batch_size, pool, emit);
+    } else if (header.kind == kCutWorkload) {
+      buildCutWorkload(n, edges, batch_size, pool, emit);
+    } else {
+      buildMixedWorkload(n, edges, batch_size, mix, engine, pool, emit);
+    }
+    std::cerr << "Check for correctness.." << std::endl;
+  }
+  if (oracle.failed()) {
+    std::cerr << "Workload \"" << filename << "\" failed the correctness check!" << std::endl;
+    exit(-1);
+  }
+  if (!writer.finish()) {
+    std::cerr << "Workload \"" << filename << "\" could not be written!" << std::endl;
     exit(-1);
   }
-  
-  // And flush the output.
-  std::ofstream output("../workloads/" + workload_type + "-" + tree_type + "-" + std::to_string(batch_size) + "-" + std::to_string(n) + ".bin");
-  output.write(reinterpret_cast<char*>(workload.data()), workload.size() * sizeof(std::pair<unsigned, unsigned>));
 }
 
 int main(int argc, char** argv) {
   // Example: Construct worload of path with n=10000 (#nodes) β=1000 (batch size): ./build_batch_workload 10000 1 random cut 1000
-  if (argc != 5) {
-    std::cerr << "Usage: " << argv[0] << " <n:unsigned> <tree_type:string[k-ary,random]> <workload_type:string[lookup,cut]> <β:unsigned[>= 100]>" << std::endl;
+  if ((argc < 5) || (argc > 8)) {
+    std::cerr << "Usage: " << argv[0] << " <n:unsigned> <tree_type:string[k-ary,random]> <workload_type:string[lookup,cut,mixed]> <β:unsigned[>= 100]> [<seed:unsigned>] [<encoding:string[plain,packed]>] [<mix:string[lookups:links:cuts]>]" << std::endl;
+    exit(-1);
+  }
+  std::string encoding = (argc >= 7) ? argv[6] : "plain";
+  if ((encoding != "plain") && (encoding != "packed")) {
+    std::cerr << "Encoding \"" << encoding << "\" not yet supported!" << std::endl;
+    exit(-1);
+  }
+  // The ratio of lookups, links and cuts in the batches of the mixed workload, e.g., 8:1:1.
+  std::array<unsigned, 3> mix = {8, 1, 1};
+  if ((argc == 8) && ((sscanf(argv[7], "%u:%u:%u", &mix[0], &mix[1], &mix[2]) != 3) || !(mix[0] + mix[1] + mix[2]) || (*std::max_element(mix.begin(), mix.end()) > UINT16_MAX))) {
+    std::cerr << "Mix \"" << argv[7] << "\" is not of the form lookups:links:cuts!" << std::endl;
     exit(-1);
   }
-  buildConcurrentWorkload(atoi(argv[1]), argv[2], argv[3], atoi(argv[4]));
+  buildConcurrentWorkload(atoi(argv[1]), argv[2], argv[3], atoi(argv[4]), (argc >= 6) ? strtoull(argv[5], nullptr, 10) : 123, (encoding == "packed") ? kPackedEncoding : kPlainEncoding, mix);
 }
@@ -0,0 +1,28 @@
+# Writes `BuildInfo.hpp` into `OUTPUT_DIR`, i.e., the git revision of `SOURCE_DIR` and the compiler flags `CXX_FLAGS`.
+# It runs on every build, so that the revision is the one of the binary, but only touches the header if it changed.
+execute_process(
+  COMMAND git describe --always --dirty --abbrev=12
+  WORKING_DIRECTORY ${SOURCE_DIR}
+  OUTPUT_VARIABLE LCT_GIT_REVISION
+  OUTPUT_STRIP_TRAILING_WHITESPACE
+  ERROR_QUIET)
+if (NOT LCT_GIT_REVISION)
+  set(LCT_GIT_REVISION "unknown")
+endif()
+string(STRIP "${CXX_FLAGS}" LCT_CXX_FLAGS)
+string(REPLACE "\"" "\\\"" LCT_CXX_FLAGS "${LCT_CXX_FLAGS}")
+
+set(CONTENT "#ifndef BUILD_INFO_HPP
+#define BUILD_INFO_HPP
+// Generated by `cmake/BuildInfo.cmake`.
+#define LCT_GIT_REVISION \"${LCT_GIT_REVISION}\"
+#define LCT_CXX_FLAGS \"${LCT_CXX_FLAGS}\"
+#endif
+")
+set(OUTPUT ${OUTPUT_DIR}/BuildInfo.hpp)
+if (EXISTS ${OUTPUT})
+  file(READ ${OUTPUT} PREVIOUS)
+endif()
+if (NOT "${PREVIOUS}" STREQUAL "${CONTENT}")
+  file(WRITE ${OUTPUT} "${CONTENT}")
+endif()
@@ -1,69 +1,238 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <random>
+#include <sstream>
 #include <chrono>
 #include <functional>
 #include <optional>
 #include <future>
 #include <csignal>
+#include <type_traits>
+#include "include/BenchReport.hpp"
+#include "include/CoarseLCT.hpp"
 #include "include/ConcurrentLCT.hpp"
+#include "include/Latches.hpp"
+#include "include/Latency.hpp"
 #include "include/LockCouplingLCT.hpp"
+#include "include/Numa.hpp"
+#include "include/Stats.hpp"
+#include "include/WorkloadFile.hpp"
+#include "include/WorkerPool.hpp"
 
 using namespace std::chrono;
 
 #define DEBUG_PRL_BENCHMARK 0
 
-using Workload = std::vector<std::pair<unsigned, unsigned>>;
+// The statistics of the trees, see the CMake option `LCT_STATS`.
+using BenchStats = std::conditional_t<LCT_STATS, CountingStats, NoStats>;
+
+// Whether the trees use shortcuts on the π-array, see the CMake option `LCT_SHORTCUTS`.
+static constexpr bool kBenchShortcuts = LCT_SHORTCUTS;
+
+using Workload = Span<WorkloadFile::Entry>;
 using WorkloadTriple = std::vector<std::tuple<unsigned, unsigned, unsigned>>;
 
+// The benchmarked variants.
+enum Variant : unsigned {
+  // `ConcurrentLinkCutTrees`: fine-grained latches, held until the operation ends.
+  kFineGrained = 0,
+  // `LockCouplingLinkCutTrees`: fine-grained latches, released hand-over-hand.
+  kLockCoupling = 1,
+  // `CoarseLinkCutTrees`: a single readers-writer latch.
+  kCoarse = 2
+};
+
+// Whether `TreeType` offers `linkBatch`, `cutBatch` and `findRootBatch`.
+template <class TreeType>
+static constexpr bool kHasBatchApi = !std::is_same_v<TreeType, CoarseLinkCutTrees<>>;
+
+// The NUMA setup of a benchmark.
+struct NumaConfig {
+  NumaTopology topology;
+  PinPolicy pinning = PinPolicy::kNone;
+  Placement placement = Placement::kDefault;
+};
+
+// The repetitions of a benchmark.
+struct RunConfig {
+  // The runs before the measured ones, e.g., to warm up the caches and the allocator.
+  unsigned warmup = 0;
+  // The measured runs.
+  unsigned repetitions = 1;
+};
+
+// The nodes of a forest. They are freed with it, so that repeated runs do not accumulate forests.
+template <class NodeType>
+struct NodeArray : std::vector<NodeType*> {
+  using std::vector<NodeType*>::vector;
+  NodeArray(const NodeArray&) = delete;
+  NodeArray& operator=(const NodeArray&) = delete;
+
+  ~NodeArray() {
+    for (auto node : *this)
+      delete node;
+  }
+};
+
+template <class TreeType, class NodeType>
+TreeType buildForest(unsigned n, std::vector<NodeType*>& nodes, WorkerPool& pool, const NumaConfig& numa) {
+// Build `n` singleton trees, with the nodes placed as `numa.placement` requests.
+// With `kInterleave`, the arrays of the trees are interleaved as well, since they are allocated by the main thread, too.
+  InterleaveScope interleave(numa.topology, numa.placement == Placement::kInterleave);
+  auto allocate = [&](uint64_t lb, uint64_t ub) {
+    for (uint64_t index = lb; index != ub; ++index) {
+      nodes[index] = new NodeType();
+      nodes[index]->label = index;
+    }
+  };
+  if ((numa.placement == Placement::kFirstTouch) && pool.size()) {
+    // Each worker allocates a contiguous range of labels. The allocator serves each thread from its own arena,
+    // so the pages are first-touched on the NUMA node of the worker. The π-array is partitioned the same way.
+    pool.run([&](unsigned workerId) {
+      allocate(static_cast<uint64_t>(n) * workerId / pool.size(), static_cast<uint64_t>(n) * (workerId + 1) / pool.size());
+    });
+    if constexpr (std::is_constructible_v<TreeType, unsigned, std::vector<NodeType*>&, WorkerPool*>)
+      return TreeType(n, nodes, &pool);
+  } else {
+    allocate(0, n);
+  }
+  return TreeType(n, nodes);
+}
+
+void reportWorkers(const WorkerPool& pool, const NumaConfig& numa) {
+// Print where the workers run.
+  if (numa.pinning == PinPolicy::kNone) {
+    std::cerr << "Workers: " << pool.size() << " unpinned" << std::endl;
+    return;
+  }
+  std::vector<unsigned> perNode;
+  std::cerr << "Workers: " << pool.size() << " pinned to cpus [";
+  for (unsigned index = 0; index != pool.size(); ++index) {
+    auto cpu = pool.cpus()[index];
+    std::cerr << (index ? "," : "") << cpu;
+    auto node = numa.topology.nodeOf(cpu);
+    if (node >= perNode.size())
+      perNode.resize(node + 1);
+    ++perNode[node];
+  }
+  std::cerr << "], per NUMA node:";
+  for (unsigned node = 0; node != perNode.size(); ++node)
+    if (perNode[node])
+      std::cerr << " node" << node << "=" << perNode[node];
+  std::cerr << std::endl;
+}
+
+// The number of mismatching lookups which are printed.
+static constexpr uint64_t kMaxReportedMismatches = 10;
+
+template <class Fn>
+std::vector<double> measure(const RunConfig& runs, LatencyRecorder& latency, Fn&& benchmark) {
+// Run `benchmark`, which returns its time, `runs.warmup` times and then `runs.repetitions` times, and return the times of the latter.
+// The statistics and the latencies cover the measured runs.
+  for (unsigned index = 0; index != runs.warmup; ++index) {
+    auto time = benchmark();
+    std::cerr << "Warmup: " << time << " ms" << std::endl;
+  }
+  latency.reset();
+#if LCT_STATS
+  CountingStats::reset();
+#endif
+  std::vector<double> times;
+  for (unsigned index = 0; index != runs.repetitions; ++index) {
+    times.push_back(benchmark());
+    std::cerr << "Benchmark: " << times.back() << " ms" << std::endl;
+  }
+  latency.report(std::cerr);
+  return times;
+}
+
+template <class NodeType>
+void checkRoot(const WorkloadFile::Entry& op, const NodeType* root, std::atomic<uint64_t>& mismatches) {
+// Compare the root found by a lookup with the one stored in the workload.
+  if (root->label == op.second)
+    return;
+  if (mismatches.fetch_add(1, std::memory_order_relaxed) < kMaxReportedMismatches)
+    std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root->label << " vs " << op.second << std::endl;
+}
+
 template <class TreeType, class NodeType>
-double lookup_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_factor, Workload& workload) { 
-  unsigned m = workload.size();
+std::vector<double> lookup_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_factor, bool grouped, unsigned checkRounds, unsigned latencySampling, const RunConfig& runs, const NumaConfig& numa, const WorkloadFile& workload) {
+
+  // The workers are shared by all batches.
+  WorkerPool pool(num_threads, numa.topology.assignCpus(num_threads, numa.pinning));
+  reportWorkers(pool, numa);
+
+  // The lookups of the correctness checks whose root differs from the stored one.
+  std::atomic<uint64_t> mismatches = 0;
+
+  // The sampled latencies. The last slot is the one of the main thread, which runs the small batches.
+  LatencyRecorder latency(num_threads + 1, latencySampling);
 
   // Perform sequential operations, when the task size is zero.
-  auto sequential = [&](TreeType& lct, std::vector<NodeType*>& nodes, unsigned lb, unsigned ub, std::string type, bool verify = false) {
+  auto sequential = [&](TreeType& lct, std::vector<NodeType*>& nodes, const Workload& ops, std::string type, bool verify = false) {
     if (type == "link") {
       // Link.
-      for (unsigned index = lb; index != ub; ++index)
-        lct.link(nodes[workload[index].first], nodes[workload[index].second]);
+      for (uint64_t index = 0; index != ops.size(); ++index)
+        latency.record(num_threads, kLink, kLink, [&]() { lct.link(nodes[ops[index].first], nodes[ops[index].second]); });
     } else if (type == "lookup") {
       // Lookup.
-      for (unsigned index = lb; index != ub; ++index) {
-        auto op = workload[index];
-        auto root = lct.findRoot(nodes[op.first]);
+      for (uint64_t index = 0; index != ops.size(); ++index) {
+        auto op = ops[index];
+        NodeType* root;
+        latency.record(num_threads, kLookup, kLookup, [&]() { root = lct.findRoot(nodes[op.first]); });
         
         // Verify.
-        if (verify) {
-          if (root->label != nodes[op.second]->label)
-            std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root->label << " vs " << nodes[op.second]->label << std::endl;
-          assert(root->label == nodes[op.second]->label);
-        }
+        if (verify)
+          checkRoot(op, root, mismatches);
       }
     } else if (type == "cut") {
       // Cut.
-      for (unsigned index = lb; index != ub; ++index) {
-        lct.cut(nodes[workload[index].first]);
+      for (uint64_t index = 0; index != ops.size(); ++index) {
+        latency.record(num_threads, kCut, kCut, [&]() { lct.cut(nodes[ops[index].first]); });
+      }
+    }
+  };
+
+  // Perform the batch through the batch API, which groups the operations by their preferred path.
+  auto grouped_batch = [&](TreeType& lct, const Workload& ops, std::string type, bool verify = false) {
+    if constexpr (kHasBatchApi<TreeType>) {
+      if (type == "link") {
+        lct.linkBatch(pool, ops.data(), ops.size(), task_factor);
+      } else if (type == "lookup") {
+        std::vector<NodeType*> roots(ops.size());
+        lct.findRootBatch(pool, ops.data(), ops.size(), roots.data(), task_factor);
+
+        // Verify, in parallel.
+        if (verify) {
+          pool.run([&](unsigned workerId) {
+            for (uint64_t index = ops.size() * workerId / pool.size(), limit = ops.size() * (workerId + 1) / pool.size(); index != limit; ++index)
+              checkRoot(ops[index], roots[index], mismatches);
+          });
+        }
+      } else if (type == "cut") {
+        lct.cutBatch(pool, ops.data(), ops.size(), task_factor);
       }
     }
   };
   
   auto checkForCorrectness = [&]() -> void {
     std::cerr << "**************** CHECK FOR CORRECTNESS ****************" << std::endl;
-    std::vector<NodeType*> nodes(n); 
-    TreeType lct(n, nodes);
-    for (unsigned index = 0; index != n; ++index) {
-      nodes[index] = new NodeType();
-      nodes[index]->label = index;
-    }
+    NodeArray<NodeType> nodes(n);
+    auto lct = buildForest<TreeType>(n, nodes, pool, numa);
     
-    auto deployLinks = [&](unsigned lb, unsigned ub) {
-      unsigned taskSize = (ub - lb) / (task_factor * num_threads);
+    auto deployLinks = [&](const Workload& ops) {
+      if (grouped) {
+        grouped_batch(lct, ops, "link", true);
+        return;
+      }
+      unsigned taskSize = ops.size() / (task_factor * num_threads);
       if (!taskSize) {
-        sequential(lct, nodes, lb, ub, "link", true);
+        sequential(lct, nodes, ops, "link", true);
         return;
       }
-      unsigned numTasks = (ub - lb) / taskSize + ((ub - lb) % taskSize != 0);
+      unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
       
       std::atomic<unsigned> taskIndex = 0;
       auto consume = [&]() -> void {
@@ -73,34 +242,32 @@ double lookup_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_fact
             return;
           
           // Compute the range.
-          unsigned startIndex = lb + (taskSize * i);
-          unsigned stopIndex = lb + (taskSize * (i + 1));
+          uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+          uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
           if (i == numTasks - 1)
-            stopIndex = ub;
+            stopIndex = ops.size();
           
           // Start linking.
-          for (unsigned index = startIndex; index != stopIndex; ++index) {
-            lct.link(nodes[workload[index].first], nodes[workload[index].second]);
+          for (uint64_t index = startIndex; index != stopIndex; ++index) {
+            lct.link(nodes[ops[index].first], nodes[ops[index].second]);
           }
         }
       };
         
-      std::vector<std::thread> threads;
-      for (unsigned index = 0, limit = num_threads; index != limit; ++index) {
-        threads.emplace_back(consume);
-      }
-      for (auto& thread : threads) {
-        thread.join();
-      }
+      pool.run([&](unsigned) { consume(); });
     };
     
-    auto deployLookups = [&](unsigned lb, unsigned ub) {
-      unsigned taskSize = (ub - lb) / (task_factor * num_threads);
+    auto deployLookups = [&](const Workload& ops) {
+      if (grouped) {
+        grouped_batch(lct, ops, "lookup", true);
+        return;
+      }
+      unsigned taskSize = ops.size() / (task_factor * num_threads);
       if (!taskSize) {
-        sequential(lct, nodes, lb, ub, "lookup", true);
+        sequential(lct, nodes, ops, "lookup", true);
         return;
       }
-      unsigned numTasks = (ub - lb) / taskSize + ((ub - lb) % taskSize != 0);
+      unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
       
       std::atomic<unsigned> taskIndex = 0;
       auto consume = [&]() -> void {
@@ -110,48 +277,38 @@ double lookup_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_fact
             return;
           
           // Compute the range.
-          unsigned startIndex = lb + (taskSize * i);
-          unsigned stopIndex = lb + (taskSize * (i + 1));
+          uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+          uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
           if (i == numTasks - 1)
-            stopIndex = ub;
+            stopIndex = ops.size();
           
-          for (unsigned index = startIndex; index != stopIndex; ++index) {
-            auto op = workload[index];
-            auto root = lct.findRoot(nodes[op.first]);
-            if (root->label != nodes[op.second]->label)
-              std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root->label << " vs " << nodes[op.second]->label << std::endl;
-            assert(root->label == nodes[op.second]->label);
+          for (uint64_t index = startIndex; index != stopIndex; ++index) {
+            checkRoot(ops[index], lct.findRoot(nodes[ops[index].first]), mismatches);
           }
         }
       };
        
-      std::vector<std::thread> threads;
-      for (unsigned index = 0, limit = num_threads; index != limit; ++index) {
-        threads.emplace_back(consume);
-      }
-      for (auto& thread : threads) {
-        thread.join();
-      }
+      pool.run([&](unsigned) { consume(); });
     };
     
-    unsigned currIndex = 0;
-    do {
-      auto elem = workload[currIndex];
-      ++currIndex;
-      
-      if (elem.first == 1) {
-        deployLinks(currIndex, currIndex + elem.second);
+    WorkloadReader reader(workload);
+    for (WorkloadBatch batch; reader.next(batch);) {
+      if (batch.kind == kLink) {
+        deployLinks(batch.ops);
       } else {
-        deployLookups(currIndex, currIndex + elem.second);
+        deployLookups(batch.ops);
       }
-      currIndex += elem.second;
-    } while (currIndex != workload.size());
+    }
   };
 
   try {
-    std::cerr << "Check for correctness.." << std::endl;
-    for (unsigned index = 0; index != 10; ++index) {
+    std::cerr << "Check for correctness (" << checkRounds << " rounds).." << std::endl;
+    for (unsigned index = 0; index != checkRounds; ++index) {
       checkForCorrectness();
+      if (mismatches.load()) {
+        std::cerr << "Correctness test failed: " << mismatches.load() << " lookups do not match the workload!" << std::endl;
+        exit(-1);
+      }
     }
   } catch (...) {
     std::cerr << "Correctness test failed!" << std::endl;
@@ -159,157 +316,172 @@ double lookup_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_fact
   }
 
   auto benchmark = [&]() -> double {
-    std::vector<NodeType*> nodes(n); 
-    TreeType lct(n, nodes);
-    for (unsigned index = 0; index != n; ++index) {
-      nodes[index] = new NodeType();
-      nodes[index]->label = index;
-    }
+    NodeArray<NodeType> nodes(n);
+    auto lct = buildForest<TreeType>(n, nodes, pool, numa);
     
-    auto deployLinks = [&](unsigned lb, unsigned ub) {
-      unsigned taskSize = (ub - lb) / (task_factor * num_threads);
+    auto deployLinks = [&](const Workload& ops) {
+      if (grouped) {
+        grouped_batch(lct, ops, "link");
+        return;
+      }
+      unsigned taskSize = ops.size() / (task_factor * num_threads);
       if (!taskSize) {
-        sequential(lct, nodes, lb, ub, "link");
+        sequential(lct, nodes, ops, "link");
         return;
       }
-      unsigned numTasks = (ub - lb) / taskSize + ((ub - lb) % taskSize != 0);
+      unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
       
       std::atomic<unsigned> taskIndex = 0;
-      auto consume = [&]() -> void {
+      auto consume = [&](unsigned workerId) -> void {
         while (taskIndex.load() < numTasks) {
           unsigned i = taskIndex++;
           if (i >= numTasks)
             return;
           
           // Compute the range.
-          unsigned startIndex = lb + (taskSize * i);
-          unsigned stopIndex = lb + (taskSize * (i + 1));
+          uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+          uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
           if (i == numTasks - 1)
-            stopIndex = ub;
+            stopIndex = ops.size();
           
           // Start linking.
-          for (unsigned index = startIndex; index != stopIndex; ++index) {
-            lct.link(nodes[workload[index].first], nodes[workload[index].second]);
+          for (uint64_t index = startIndex; index != stopIndex; ++index) {
+            latency.record(workerId, kLink, kLink, [&]() { lct.link(nodes[ops[index].first], nodes[ops[index].second]); });
           }
         }
       };
         
-      std::vector<std::thread> threads;
-      for (unsigned index = 0, limit = num_threads; index != limit; ++index) {
-        threads.emplace_back(consume);
-      }
-      for (auto& thread : threads) {
-        thread.join();
-      }
+      pool.run([&](unsigned workerId) { consume(workerId); });
     };
     
-    auto deployLookups = [&](unsigned lb, unsigned ub) {
-      unsigned taskSize = (ub - lb) / (task_factor * num_threads);
+    auto deployLookups = [&](const Workload& ops) {
+      if (grouped) {
+        grouped_batch(lct, ops, "lookup");
+        return;
+      }
+      unsigned taskSize = ops.size() / (task_factor * num_threads);
       if (!taskSize) {
-        sequential(lct, nodes, lb, ub, "lookup");
+        sequential(lct, nodes, ops, "lookup");
         return;
       }
-      unsigned numTasks = (ub - lb) / taskSize + ((ub - lb) % taskSize != 0);
+      unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
       
       std::atomic<unsigned> taskIndex = 0;
-      auto consume = [&]() -> void {
+      auto consume = [&](unsigned workerId) -> void {
         while (taskIndex.load() < numTasks) {
           unsigned i = taskIndex++;
           if (i >= numTasks)
             return;
           
           // Compute the range.
-          unsigned startIndex = lb + (taskSize * i);
-          unsigned stopIndex = lb + (taskSize * (i + 1));
+          uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+          uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
           if (i == numTasks - 1)
-            stopIndex = ub;
+            stopIndex = ops.size();
           
-          for (unsigned index = startIndex; index != stopIndex; ++index) {
-            auto root = lct.findRoot(nodes[workload[index].first]);
+          for (uint64_t index = startIndex; index != stopIndex; ++index) {
+            latency.record(workerId, kLookup, kLookup, [&]() { lct.findRoot(nodes[ops[index].first]); });
           }
         }
       };
         
-      std::vector<std::thread> threads;
-      for (unsigned index = 0, limit = num_threads; index != limit; ++index) {
-        threads.emplace_back(consume);
-      }
-      for (auto& thread : threads) {
-        thread.join();
-      }
+      pool.run([&](unsigned workerId) { consume(workerId); });
     };
     
     
     std::cerr << "Start workload.." << std::endl;
+    WorkloadReader reader(workload);
     auto start = high_resolution_clock::now();
-    unsigned currIndex = 0;
-    do {
-      auto elem = workload[currIndex];
-      ++currIndex;
-      
-      if (elem.first == 1) {
-        deployLinks(currIndex, currIndex + elem.second);
+    for (WorkloadBatch batch; reader.next(batch);) {
+      if (batch.kind == kLink) {
+        deployLinks(batch.ops);
       } else {
-        deployLookups(currIndex, currIndex + elem.second);
+        deployLookups(batch.ops);
       }
-      currIndex += elem.second;
-    } while (currIndex != workload.size());
+    }
     auto stop = high_resolution_clock::now();
     std::cerr << "Finished workload!" << std::endl;
-    return duration_cast<milliseconds>(stop - start).count();
+    return duration<double, std::milli>(stop - start).count();
   };
   
   try {
-    auto time = benchmark();
-    std::cerr << "Benchmark: " << time << " ms" << std::endl;
-    return time;
+    return measure(runs, latency, benchmark);
   } catch (...) {
     std::cerr << "Benchmark failed!" << std::endl;
     assert(0);
   }
-  return 0;
+  return {};
 }
 
 template <class TreeType, class NodeType>
-double cut_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_factor, Workload& workload) {  
-  auto sequential = [&](TreeType& lct, std::vector<NodeType*>& nodes, unsigned lb, unsigned ub, std::string type, bool verify = false) {
+std::vector<double> cut_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_factor, bool grouped, unsigned checkRounds, unsigned latencySampling, const RunConfig& runs, const NumaConfig& numa, const WorkloadFile& workload) {
+  // The workers are shared by all batches.
+  WorkerPool pool(num_threads, numa.topology.assignCpus(num_threads, numa.pinning));
+  reportWorkers(pool, numa);
+
+  // The lookups of the correctness checks whose root differs from the stored one.
+  std::atomic<uint64_t> mismatches = 0;
+
+  // The sampled latencies. The last slot is the one of the main thread, which runs the small batches.
+  LatencyRecorder latency(num_threads + 1, latencySampling);
+
+  auto sequential = [&](TreeType& lct, std::vector<NodeType*>& nodes, const Workload& ops, std::string type, bool verify = false) {
     if (type == "link") {
-      for (unsigned index = lb; index != ub; ++index)
-        lct.link(nodes[workload[index].first], nodes[workload[index].second]);
+      for (uint64_t index = 0; index != ops.size(); ++index)
+        latency.record(num_threads, kLink, kLink, [&]() { lct.link(nodes[ops[index].first], nodes[ops[index].second]); });
     } else if (type == "lookup") {
-      for (unsigned index = lb; index != ub; ++index) {
-        auto op = workload[index];
-        auto root = lct.findRoot(nodes[op.first]);
-        if (verify) {
-          if (root->label != nodes[op.second]->label)
-            std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root->label << " vs " << nodes[op.second]->label << std::endl;
-          assert(root->label == nodes[op.second]->label);
-        }
+      for (uint64_t index = 0; index != ops.size(); ++index) {
+        auto op = ops[index];
+        NodeType* root;
+        latency.record(num_threads, kLookup, kLookup, [&]() { root = lct.findRoot(nodes[op.first]); });
+        if (verify)
+          checkRoot(op, root, mismatches);
       }
     } else if (type == "cut") {
-      for (unsigned index = lb; index != ub; ++index) {
-        lct.cut(nodes[workload[index].first]);
+      for (uint64_t index = 0; index != ops.size(); ++index) {
+        latency.record(num_threads, kCut, kCut, [&]() { lct.cut(nodes[ops[index].first]); });
+      }
+    }
+  };
+
+  // Perform the batch through the batch API, which groups the operations by their preferred path.
+  auto grouped_batch = [&](TreeType& lct, const Workload& ops, std::string type, bool verify = false) {
+    if constexpr (kHasBatchApi<TreeType>) {
+      if (type == "link") {
+        lct.linkBatch(pool, ops.data(), ops.size(), task_factor);
+      } else if (type == "lookup") {
+        std::vector<NodeType*> roots(ops.size());
+        lct.findRootBatch(pool, ops.data(), ops.size(), roots.data(), task_factor);
+
+        // Verify, in parallel.
+        if (verify) {
+          pool.run([&](unsigned workerId) {
+            for (uint64_t index = ops.size() * workerId / pool.size(), limit = ops.size() * (workerId + 1) / pool.size(); index != limit; ++index)
+              checkRoot(ops[index], roots[index], mismatches);
+          });
+        }
+      } else if (type == "cut") {
+        lct.cutBatch(pool, ops.data(), ops.size(), task_factor);
       }
     }
   };
   
-  unsigned m = workload.size();
   auto checkForCorrectness = [&]() -> void {
     std::cerr << "**************** CHECK FOR CORRECTNESS ****************" << std::endl;
-    std::vector<NodeType*> nodes(n); 
-    TreeType lct(n, nodes);
-    for (unsigned index = 0; index != n; ++index) {
-      nodes[index] = new NodeType();
-      nodes[index]->label = index;
-    }
+    NodeArray<NodeType> nodes(n);
+    auto lct = buildForest<TreeType>(n, nodes, pool, numa);
     
-    auto deployCuts = [&](unsigned lb, unsigned ub) {
-      unsigned taskSize = (ub - lb) / (task_factor * num_threads);
+    auto deployCuts = [&](const Workload& ops) {
+      if (grouped) {
+        grouped_batch(lct, ops, "cut", true);
+        return;
+      }
+      unsigned taskSize = ops.size() / (task_factor * num_threads);
       if (!taskSize) {
-        sequential(lct, nodes, lb, ub, "cut", true);
+        sequential(lct, nodes, ops, "cut", true);
         return;
       }
-      unsigned numTasks = (ub - lb) / taskSize + ((ub - lb) % taskSize != 0);
+      unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
       
       std::atomic<unsigned> taskIndex = 0;
       auto consume = [&]() -> void {
@@ -319,34 +491,32 @@ double cut_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_factor,
             return;
           
           // Compute the range.
-          unsigned startIndex = lb + (taskSize * i);
-          unsigned stopIndex = lb + (taskSize * (i + 1));
+          uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+          uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
           if (i == numTasks - 1)
-            stopIndex = ub;
+            stopIndex = ops.size();
           
           // Start linking.
-          for (unsigned index = startIndex; index != stopIndex; ++index) {
-            lct.cut(nodes[workload[index].first]);
+          for (uint64_t index = startIndex; index != stopIndex; ++index) {
+            lct.cut(nodes[ops[index].first]);
           }
         }
       };
         
-      std::vector<std::thread> threads;
-      for (unsigned index = 0, limit = num_threads; index != limit; ++index) {
-        threads.emplace_back(consume);
-      }
-      for (auto& thread : threads) {
-        thread.join();
-      }
+      pool.run([&](unsigned) { consume(); });
     };
     
-    auto deployLinks = [&](unsigned lb, unsigned ub) {
-      unsigned taskSize = (ub - lb) / (task_factor * num_threads);
+    auto deployLinks = [&](const Workload& ops) {
+      if (grouped) {
+        grouped_batch(lct, ops, "link", true);
+        return;
+      }
+      unsigned taskSize = ops.size() / (task_factor * num_threads);
       if (!taskSize) {
-        sequential(lct, nodes, lb, ub, "link", true);
+        sequential(lct, nodes, ops, "link", true);
         return;
       }
-      unsigned numTasks = (ub - lb) / taskSize + ((ub - lb) % taskSize != 0);
+      unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
       
       std::atomic<unsigned> taskIndex = 0;
       auto consume = [&]() -> void {
@@ -356,34 +526,32 @@ double cut_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_factor,
             return;
           
           // Compute the range.
-          unsigned startIndex = lb + (taskSize * i);
-          unsigned stopIndex = lb + (taskSize * (i + 1));
+          uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+          uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
           if (i == numTasks - 1)
-            stopIndex = ub;
+            stopIndex = ops.size();
           
           // Start linking.
-          for (unsigned index = startIndex; index != stopIndex; ++index) {
-            lct.link(nodes[workload[index].first], nodes[workload[index].second]);
+          for (uint64_t index = startIndex; index != stopIndex; ++index) {
+            lct.link(nodes[ops[index].first], nodes[ops[index].second]);
           }
         }
       };
         
-      std::vector<std::thread> threads;
-      for (unsigned index = 0, limit = num_threads; index != limit; ++index) {
-        threads.emplace_back(consume);
-      }
-      for (auto& thread : threads) {
-        thread.join();
-      }
+      pool.run([&](unsigned) { consume(); });
     };
     
-    auto deployLookups = [&](unsigned lb, unsigned ub) {
-      unsigned taskSize = (ub - lb) / (task_factor * num_threads);
+    auto deployLookups = [&](const Workload& ops) {
+      if (grouped) {
+        grouped_batch(lct, ops, "lookup", true);
+        return;
+      }
+      unsigned taskSize = ops.size() / (task_factor * num_threads);
       if (!taskSize) {
-        sequential(lct, nodes, lb, ub, "lookup", true);
+        sequential(lct, nodes, ops, "lookup", true);
         return;
       }
-      unsigned numTasks = (ub - lb) / taskSize + ((ub - lb) % taskSize != 0);
+      unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
       
       std::atomic<unsigned> taskIndex = 0;
       auto consume = [&]() -> void {
@@ -393,50 +561,40 @@ double cut_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_factor,
             return;
           
           // Compute the range.
-          unsigned startIndex = lb + (taskSize * i);
-          unsigned stopIndex = lb + (taskSize * (i + 1));
+          uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+          uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
           if (i == numTasks - 1)
-            stopIndex = ub;
+            stopIndex = ops.size();
           
-          for (unsigned index = startIndex; index != stopIndex; ++index) {
-            auto op = workload[index];
-            auto root = lct.findRoot(nodes[op.first]);
-            if (root->label != nodes[op.second]->label)
-              std::cerr << "op=(" << op.first << "," << op.second << ") root=" << root->label << " vs " << nodes[op.second]->label << std::endl;
-            assert(root->label == nodes[op.second]->label);
+          for (uint64_t index = startIndex; index != stopIndex; ++index) {
+            checkRoot(ops[index], lct.findRoot(nodes[ops[index].first]), mismatches);
           }
         }
       };
         
-      std::vector<std::thread> threads;
-      for (unsigned index = 0, limit = num_threads; index != limit; ++index) {
-        threads.emplace_back(consume);
-      }
-      for (auto& thread : threads) {
-        thread.join();
-      }
+      pool.run([&](unsigned) { consume(); });
     };
     
-    unsigned currIndex = 0;
-    do {
-      auto elem = workload[currIndex];
-      ++currIndex;
-      
-      if (elem.first == 1) {
-        deployLinks(currIndex, currIndex + elem.second);
-      } else if (elem.first == 2) {
-        deployCuts(currIndex, currIndex + elem.second);
+    WorkloadReader reader(workload);
+    for (WorkloadBatch batch; reader.next(batch);) {
+      if (batch.kind == kLink) {
+        deployLinks(batch.ops);
+      } else if (batch.kind == kCut) {
+        deployCuts(batch.ops);
       } else {
-        deployLookups(currIndex, currIndex + elem.second);
+        deployLookups(batch.ops);
       }
-      currIndex += elem.second;
-    } while (currIndex != workload.size());
+    }
   };
 
   try {
-    std::cerr << "Check for correctness.." << std::endl;
-    for (unsigned index = 0; index != 10; ++index) {
+    std::cerr << "Check for correctness (" << checkRounds << " rounds).." << std::endl;
+    for (unsigned index = 0; index != checkRounds; ++index) {
       checkForCorrectness();
+      if (mismatches.load()) {
+        std::cerr << "Correctness test failed: " << mismatches.load() << " lookups do not match the workload!" << std::endl;
+        exit(-1);
+      }
     }
   } catch (...) {
     std::cerr << "Correctness test failed!" << std::endl;
@@ -444,234 +602,541 @@ double cut_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_factor,
   }
 
   auto benchmark = [&]() -> double {
-    std::vector<NodeType*> nodes(n); 
-    TreeType lct(n, nodes);
-    for (unsigned index = 0; index != n; ++index) {
-      nodes[index] = new NodeType();
-      nodes[index]->label = index;
-    }
+    NodeArray<NodeType> nodes(n);
+    auto lct = buildForest<TreeType>(n, nodes, pool, numa);
     
-    auto deployCuts = [&](unsigned lb, unsigned ub) {
-      unsigned taskSize = (ub - lb) / (task_factor * num_threads);
+    auto deployCuts = [&](const Workload& ops) {
+      if (grouped) {
+        grouped_batch(lct, ops, "cut");
+        return;
+      }
+      unsigned taskSize = ops.size() / (task_factor * num_threads);
       if (!taskSize) {
-        sequential(lct, nodes, lb, ub, "cut");
+        sequential(lct, nodes, ops, "cut");
         return;
       }
-      unsigned numTasks = (ub - lb) / taskSize + ((ub - lb) % taskSize != 0);
+      unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
       
       std::atomic<unsigned> taskIndex = 0;
-      auto consume = [&]() -> void {
+      auto consume = [&](unsigned workerId) -> void {
         while (taskIndex.load() < numTasks) {
           unsigned i = taskIndex++;
           if (i >= numTasks)
             return;
           
           // Compute the range.
-          unsigned startIndex = lb + (taskSize * i);
-          unsigned stopIndex = lb + (taskSize * (i + 1));
+          uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+          uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
           if (i == numTasks - 1)
-            stopIndex = ub;
+            stopIndex = ops.size();
           
           // Start linking.
-          for (unsigned index = startIndex; index != stopIndex; ++index) {
-            lct.cut(nodes[workload[index].first]);
+          for (uint64_t index = startIndex; index != stopIndex; ++index) {
+            latency.record(workerId, kCut, kCut, [&]() { lct.cut(nodes[ops[index].first]); });
           }
         }
       };
         
-      std::vector<std::thread> threads;
-      for (unsigned index = 0, limit = num_threads; index != limit; ++index) {
-        threads.emplace_back(consume);
-      }
-      for (auto& thread : threads) {
-        thread.join();
-      }
+      pool.run([&](unsigned workerId) { consume(workerId); });
     };
     
-    auto deployLinks = [&](unsigned lb, unsigned ub) {
-      unsigned taskSize = (ub - lb) / (task_factor * num_threads);
+    auto deployLinks = [&](const Workload& ops) {
+      if (grouped) {
+        grouped_batch(lct, ops, "link");
+        return;
+      }
+      unsigned taskSize = ops.size() / (task_factor * num_threads);
       if (!taskSize) {
-        sequential(lct, nodes, lb, ub, "link");
+        sequential(lct, nodes, ops, "link");
         return;
       }
-      unsigned numTasks = (ub - lb) / taskSize + ((ub - lb) % taskSize != 0);
+      unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
       
       std::atomic<unsigned> taskIndex = 0;
-      auto consume = [&]() -> void {
+      auto consume = [&](unsigned workerId) -> void {
         while (taskIndex.load() < numTasks) {
           unsigned i = taskIndex++;
           if (i >= numTasks)
             return;
           
           // Compute the range.
-          unsigned startIndex = lb + (taskSize * i);
-          unsigned stopIndex = lb + (taskSize * (i + 1));
+          uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+          uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
           if (i == numTasks - 1)
-            stopIndex = ub;
+            stopIndex = ops.size();
           
           // Start linking.
-          for (unsigned index = startIndex; index != stopIndex; ++index) {
-            lct.link(nodes[workload[index].first], nodes[workload[index].second]);
+          for (uint64_t index = startIndex; index != stopIndex; ++index) {
+            latency.record(workerId, kLink, kLink, [&]() { lct.link(nodes[ops[index].first], nodes[ops[index].second]); });
           }
         }
       }; 
-      std::vector<std::thread> threads;
-      for (unsigned index = 0, limit = num_threads; index != limit; ++index) {
-        threads.emplace_back(consume);
-      }
-      for (auto& thread : threads) {
-        thread.join();
-      }
+      pool.run([&](unsigned workerId) { consume(workerId); });
     };
     
-    auto deployLookups = [&](unsigned lb, unsigned ub) {
-      unsigned taskSize = (ub - lb) / (task_factor * num_threads);
+    auto deployLookups = [&](const Workload& ops) {
+      if (grouped) {
+        grouped_batch(lct, ops, "lookup");
+        return;
+      }
+      unsigned taskSize = ops.size() / (task_factor * num_threads);
       if (!taskSize) {
-        sequential(lct, nodes, lb, ub, "lookup");
+        sequential(lct, nodes, ops, "lookup");
         return;
       }
-      unsigned numTasks = (ub - lb) / taskSize + ((ub - lb) % taskSize != 0);
+      unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
       
       std::atomic<unsigned> taskIndex = 0;
-      auto consume = [&]() -> void {
+      auto consume = [&](unsigned workerId) -> void {
         while (taskIndex.load() < numTasks) {
           unsigned i = taskIndex++;
           if (i >= numTasks)
             return;
           
           // Compute the range.
-          unsigned startIndex = lb + (taskSize * i);
-          unsigned stopIndex = lb + (taskSize * (i + 1));
+          uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+          uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
           if (i == numTasks - 1)
-            stopIndex = ub;
+            stopIndex = ops.size();
           
-          for (unsigned index = startIndex; index != stopIndex; ++index) {
-            auto root = lct.findRoot(nodes[workload[index].first]);
+          for (uint64_t index = startIndex; index != stopIndex; ++index) {
+            latency.record(workerId, kLookup, kLookup, [&]() { lct.findRoot(nodes[ops[index].first]); });
           }
         }
       }; 
-      std::vector<std::thread> threads;
-      for (unsigned index = 0, limit = num_threads; index != limit; ++index) {
-        threads.emplace_back(consume);
-      }
-      for (auto& thread : threads) {
-        thread.join();
-      }
+      pool.run([&](unsigned workerId) { consume(workerId); });
     };
     
     
     std::cerr << "Start workload.." << std::endl;
+    WorkloadReader reader(workload);
     auto start = high_resolution_clock::now();
-    unsigned currIndex = 0;
-    do {
-      auto elem = workload[currIndex];
-      ++currIndex;
-
-      if (elem.first == 1) {
-        deployLinks(currIndex, currIndex + elem.second);
-      } else if (elem.first == 2) {
-        deployCuts(currIndex, currIndex + elem.second);
+    for (WorkloadBatch batch; reader.next(batch);) {
+      if (batch.kind == kLink) {
+        deployLinks(batch.ops);
+      } else if (batch.kind == kCut) {
+        deployCuts(batch.ops);
       } else {
-        deployLookups(currIndex, currIndex + elem.second);
+        deployLookups(batch.ops);
       }
-      currIndex += elem.second;
-    } while (currIndex != workload.size());
+    }
     auto stop = high_resolution_clock::now();
     std::cerr << "Finished workload!" << std::endl;
-    return duration_cast<milliseconds>(stop - start).count();
+    return duration<double, std::milli>(stop - start).count();
   };
   
   try {
-    auto time = benchmark();std::cerr << "Benchmark: " << time << " ms" << std::endl;
-    return time;
+    return measure(runs, latency, benchmark);
   } catch (...) {
     std::cerr << "Benchmark failed!" << std::endl;
     assert(0);
   }
-  return 0;
+  return {};
 }
 
-double lookup_benchmark(std::string filename, unsigned n, unsigned num_threads, unsigned task_factor, unsigned lock_coupling) {
-  Workload workload;
-  std::ifstream input(filename);
-  if (!input.is_open()) {
-    std::cerr << "Workload \"" << filename << "\" could not be loaded. Check its existance!" << std::endl;
-    exit(-1);
+template <class TreeType, class NodeType>
+std::vector<double> mixed_benchmark_lct(unsigned n, unsigned num_threads, unsigned task_factor, unsigned checkRounds, unsigned latencySampling, const RunConfig& runs, const NumaConfig& numa, const WorkloadFile& workload) {
+  // The workers are shared by all batches.
+  WorkerPool pool(num_threads, numa.topology.assignCpus(num_threads, numa.pinning));
+  reportWorkers(pool, numa);
+
+  // The lookups of the correctness checks whose root differs from the stored one.
+  std::atomic<uint64_t> mismatches = 0;
+
+  // The sampled latencies. The last slot is the one of the main thread, which runs the small batches.
+  LatencyRecorder latency(num_threads + 1, latencySampling);
+
+  // Execute an operation of a batch of `kind`. The operations of a mixed batch carry their own kind.
+  // `slot` is the one of the thread in `latency`.
+  auto execute = [&](TreeType& lct, std::vector<NodeType*>& nodes, OpKind kind, const WorkloadFile::Entry& op, bool verify, unsigned slot) {
+    auto phase = kind;
+    unsigned u = op.first;
+    if (kind == kMixed) {
+      kind = MixedOp::kind(u);
+      u = MixedOp::label(u);
+    }
+    if (kind == kLink) {
+      latency.record(slot, phase, kLink, [&]() { lct.link(nodes[u], nodes[op.second]); });
+    } else if (kind == kCut) {
+      latency.record(slot, phase, kCut, [&]() { lct.cut(nodes[u]); });
+    } else {
+      NodeType* root;
+      latency.record(slot, phase, kLookup, [&]() { root = lct.findRoot(nodes[u]); });
+      if (verify)
+        checkRoot(WorkloadFile::Entry(u, op.second), root, mismatches);
+    }
+  };
+
+  // Deploy a batch. The workers claim its slices, so that in a mixed batch, all of them run lookups, links and cuts at the same time.
+  auto deploy = [&](TreeType& lct, std::vector<NodeType*>& nodes, const WorkloadBatch& batch, bool verify) {
+    auto& ops = batch.ops;
+    unsigned taskSize = ops.size() / (task_factor * num_threads);
+    if (!taskSize) {
+      for (uint64_t index = 0; index != ops.size(); ++index)
+        execute(lct, nodes, batch.kind, ops[index], verify, num_threads);
+      return;
+    }
+    unsigned numTasks = ops.size() / taskSize + (ops.size() % taskSize != 0);
+
+    std::atomic<unsigned> taskIndex = 0;
+    auto consume = [&](unsigned workerId) -> void {
+      while (taskIndex.load() < numTasks) {
+        unsigned i = taskIndex++;
+        if (i >= numTasks)
+          return;
+
+        // Compute the range.
+        uint64_t startIndex = static_cast<uint64_t>(taskSize) * i;
+        uint64_t stopIndex = static_cast<uint64_t>(taskSize) * (i + 1);
+        if (i == numTasks - 1)
+          stopIndex = ops.size();
+
+        for (uint64_t index = startIndex; index != stopIndex; ++index)
+          execute(lct, nodes, batch.kind, ops[index], verify, workerId);
+      }
+    };
+
+    pool.run([&](unsigned workerId) { consume(workerId); });
+  };
+
+  auto run = [&](bool verify) -> double {
+  // Run the workload on a fresh forest and return its time.
+    NodeArray<NodeType> nodes(n);
+    auto lct = buildForest<TreeType>(n, nodes, pool, numa);
+    WorkloadReader reader(workload);
+    auto start = high_resolution_clock::now();
+    for (WorkloadBatch batch; reader.next(batch);)
+      deploy(lct, nodes, batch, verify);
+    auto stop = high_resolution_clock::now();
+    return duration<double, std::milli>(stop - start).count();
+  };
+
+  std::cerr << "Check for correctness (" << checkRounds << " rounds).." << std::endl;
+  for (unsigned index = 0; index != checkRounds; ++index) {
+    std::cerr << "**************** CHECK FOR CORRECTNESS ****************" << std::endl;
+    run(true);
+    if (mismatches.load()) {
+      std::cerr << "Correctness test failed: " << mismatches.load() << " lookups do not match the workload!" << std::endl;
+      exit(-1);
+    }
   }
-  
-  std::cerr << "Start loading workload.." << std::endl;
-  auto pos = input.tellg();
-  input.seekg(0, std::ios::end);  
-  auto size = input.tellg() - pos;
-  input.seekg(0, std::ios::beg);
-  unsigned elements = size / sizeof(std::pair<unsigned, unsigned>);
-  workload.resize(elements);
-  input.read(reinterpret_cast<char*>(workload.data()), elements * sizeof(std::pair<unsigned, unsigned>));
-  unsigned m = workload.size();
-
-  std::cerr << "---------------- New benchmark (lock_coupling=" << lock_coupling << ") ----------------" << std::endl;
-  return (!lock_coupling) ? lookup_benchmark_lct<ConcurrentLinkCutTrees, ConcurrentLinkCutTrees::CoNode>(n, num_threads, task_factor, workload)
-                          : lookup_benchmark_lct<LockCouplingLinkCutTrees, LockCouplingLinkCutTrees::CoNode>(n, num_threads, task_factor, workload);
+
+  return measure(runs, latency, [&]() {
+    std::cerr << "Start workload.." << std::endl;
+    auto time = run(false);
+    std::cerr << "Finished workload!" << std::endl;
+    return time;
+  });
+}
+
+template <class Latch>
+std::vector<double> lookup_benchmark(const WorkloadFile& workload, unsigned n, unsigned num_threads, unsigned task_factor, unsigned variant, bool grouped, unsigned checkRounds, unsigned latencySampling, const RunConfig& runs, const NumaConfig& numa) {
+  std::cerr << "---------------- New benchmark (variant=" << variant << ", schedule=" << (grouped ? "grouped" : "slices") << ") ----------------" << std::endl;
+  using CoTree = ConcurrentLinkCutTrees<Latch, false, NoAggregate, BenchStats, kBenchShortcuts>;
+  using LockCouplingTree = LockCouplingLinkCutTrees<Latch, NoAggregate, BenchStats, kBenchShortcuts>;
+  using CoarseTree = CoarseLinkCutTrees<>;
+  if (variant == kFineGrained)
+    return lookup_benchmark_lct<CoTree, typename CoTree::CoNode>(n, num_threads, task_factor, grouped, checkRounds, latencySampling, runs, numa, workload);
+  if (variant == kLockCoupling)
+    return lookup_benchmark_lct<LockCouplingTree, typename LockCouplingTree::CoNode>(n, num_threads, task_factor, grouped, checkRounds, latencySampling, runs, numa, workload);
+  return lookup_benchmark_lct<CoarseTree, typename CoarseTree::CoNode>(n, num_threads, task_factor, grouped, checkRounds, latencySampling, runs, numa, workload);
+}
+
+template <class Latch>
+std::vector<double> cut_benchmark(const WorkloadFile& workload, unsigned n, unsigned num_threads, unsigned task_factor, unsigned variant, bool grouped, unsigned checkRounds, unsigned latencySampling, const RunConfig& runs, const NumaConfig& numa) {
+  std::cerr << "---------------- New benchmark (variant=" << variant << ", schedule=" << (grouped ? "grouped" : "slices") << ") ----------------" << std::endl;
+  using CoTree = ConcurrentLinkCutTrees<Latch, false, NoAggregate, BenchStats, kBenchShortcuts>;
+  using LockCouplingTree = LockCouplingLinkCutTrees<Latch, NoAggregate, BenchStats, kBenchShortcuts>;
+  using CoarseTree = CoarseLinkCutTrees<>;
+  if (variant == kFineGrained)
+    return cut_benchmark_lct<CoTree, typename CoTree::CoNode>(n, num_threads, task_factor, grouped, checkRounds, latencySampling, runs, numa, workload);
+  if (variant == kLockCoupling)
+    return cut_benchmark_lct<LockCouplingTree, typename LockCouplingTree::CoNode>(n, num_threads, task_factor, grouped, checkRounds, latencySampling, runs, numa, workload);
+  return cut_benchmark_lct<CoarseTree, typename CoarseTree::CoNode>(n, num_threads, task_factor, grouped, checkRounds, latencySampling, runs, numa, workload);
+}
+
+template <class Latch>
+std::vector<double> mixed_benchmark(const WorkloadFile& workload, unsigned n, unsigned num_threads, unsigned task_factor, unsigned variant, unsigned checkRounds, unsigned latencySampling, const RunConfig& runs, const NumaConfig& numa) {
+  std::cerr << "---------------- New benchmark (variant=" << variant << ", schedule=slices) ----------------" << std::endl;
+  using CoTree = ConcurrentLinkCutTrees<Latch, false, NoAggregate, BenchStats, kBenchShortcuts>;
+  using LockCouplingTree = LockCouplingLinkCutTrees<Latch, NoAggregate, BenchStats, kBenchShortcuts>;
+  using CoarseTree = CoarseLinkCutTrees<>;
+  if (variant == kFineGrained)
+    return mixed_benchmark_lct<CoTree, typename CoTree::CoNode>(n, num_threads, task_factor, checkRounds, latencySampling, runs, numa, workload);
+  if (variant == kLockCoupling)
+    return mixed_benchmark_lct<LockCouplingTree, typename LockCouplingTree::CoNode>(n, num_threads, task_factor, checkRounds, latencySampling, runs, numa, workload);
+  return mixed_benchmark_lct<CoarseTree, typename CoarseTree::CoNode>(n, num_threads, task_factor, checkRounds, latencySampling, runs, numa, workload);
 }
 
-double cut_benchmark(std::string filename, unsigned n, unsigned num_threads, unsigned task_factor, unsigned lock_coupling) {
-  Workload workload;
-  std::ifstream input(filename);
-  if (!input.is_open()) {
-    std::cerr << "Workload \"" << filename << "\" could not be loaded. Check its existance!" << std::endl;
+template <class Latch>
+struct LatchTag { using type = Latch; };
+
+template <class Fn>
+auto dispatchLatch(std::string latch, Fn&& fn) {
+// Instantiate `fn` with the latch policy named `latch`.
+  if (latch == "mutex") {
+    return fn(LatchTag<std::mutex>{});
+  } else if (latch == "ttas") {
+    return fn(LatchTag<TTASLatch>{});
+  } else if (latch == "mcs") {
+    return fn(LatchTag<MCSLatch>{});
+  }
+  std::cerr << "Latch \"" << latch << "\" not yet supported!" << std::endl;
+  exit(-1);
+}
+
+std::string workloadName(const WorkloadHeader& header) {
+// The kind of the workload, with the ratio of lookups, links and cuts if mixed.
+  std::string type = workloadKindName(header.kind);
+  if (header.kind == kMixedWorkload)
+    type += " " + std::to_string(header.mix[0]) + ":" + std::to_string(header.mix[1]) + ":" + std::to_string(header.mix[2]);
+  return type;
+}
+
+static const char* variantName(unsigned variant) {
+  static const char* names[] = {"fine-grained", "lock-coupling", "coarse"};
+  return names[variant];
+}
+
+std::string latchName(unsigned variant, const std::string& latch) {
+// The latch which `variant` actually takes: the coarse variant has its own readers-writer latch.
+  return (variant == kCoarse) ? "shared_mutex" : latch;
+}
+
+static const char* pinningName(PinPolicy pinning) {
+  static const char* names[] = {"none", "compact", "scatter"};
+  return names[static_cast<unsigned>(pinning)];
+}
+
+static const char* placementName(Placement placement) {
+  static const char* names[] = {"default", "first-touch", "interleave"};
+  return names[static_cast<unsigned>(placement)];
+}
+
+void warnIgnoredLatch(const std::string& latch) {
+  std::cerr << "Warning: the coarse variant takes a std::shared_mutex, the latch \"" << latch << "\" only applies to the other variants." << std::endl;
+}
+
+void openWorkload(const WorkloadFile& file, const std::string& filename) {
+// Check that the workload could be opened.
+  if (!file.isOpen()) {
+    std::cerr << "Workload \"" << filename << "\" " << file.error() << "!" << std::endl;
     exit(-1);
   }
-  
+}
+
+std::vector<double> runBenchmark(const WorkloadFile& file, unsigned num_threads, unsigned task_factor, unsigned variant, std::string latch, bool grouped, unsigned checkRounds, unsigned latencySampling, const RunConfig& runs, const NumaConfig& numa) {
+// Benchmark the workload of `file` and return the times of the measured runs.
+  auto& header = file.header();
+  unsigned n = file.n();
+  if (header.kind == kCutWorkload) {
+    return dispatchLatch(latch, [&](auto tag) {
+      return cut_benchmark<typename decltype(tag)::type>(file, n, num_threads, task_factor, variant, grouped, checkRounds, latencySampling, runs, numa);
+    });
+  } else if (header.kind == kLookupWorkload) {
+    return dispatchLatch(latch, [&](auto tag) {
+      return lookup_benchmark<typename decltype(tag)::type>(file, n, num_threads, task_factor, variant, grouped, checkRounds, latencySampling, runs, numa);
+    });
+  } else if (header.kind == kMixedWorkload) {
+    if (grouped) {
+      std::cerr << "The grouped schedule needs batches of a single kind!" << std::endl;
+      exit(-1);
+    }
+    return dispatchLatch(latch, [&](auto tag) {
+      return mixed_benchmark<typename decltype(tag)::type>(file, n, num_threads, task_factor, variant, checkRounds, latencySampling, runs, numa);
+    });
+  }
+  std::cerr << "Not supported yet!" << std::endl;
+  exit(-1);
+}
+
+void benchmark(std::string filename, unsigned num_threads, unsigned task_factor, unsigned variant = kFineGrained, std::string latch = "mutex", bool grouped = false, unsigned checkRounds = 10, unsigned latencySampling = 0, const NumaConfig& numa = {}) {
   std::cerr << "Start loading workload.." << std::endl;
-  auto pos = input.tellg();
-  input.seekg(0, std::ios::end);  
-  auto size = input.tellg() - pos;
-  input.seekg(0, std::ios::beg);
-  unsigned elements = size / sizeof(std::pair<unsigned, unsigned>);
-  workload.resize(elements);
-  input.read(reinterpret_cast<char*>(workload.data()), elements * sizeof(std::pair<unsigned, unsigned>));
-  unsigned m = workload.size();
-
-  std::cerr << "---------------- New benchmark (lock_coupling=" << lock_coupling << ") ----------------" << std::endl;
-  return (!lock_coupling) ? cut_benchmark_lct<ConcurrentLinkCutTrees, ConcurrentLinkCutTrees::CoNode>(n, num_threads, task_factor, workload)
-                          : cut_benchmark_lct<LockCouplingLinkCutTrees, LockCouplingLinkCutTrees::CoNode>(n, num_threads, task_factor, workload);
+  WorkloadFile file(filename);
+  openWorkload(file, filename);
+  auto& header = file.header();
+  std::string type = workloadName(header);
+  unsigned n = file.n();
+
+  std::cerr << "Start benchmarking \"" << type << " (n=" << n << ", " << header.treeType() << ", β=" << header.batchSize << ", seed=" << header.seed << ")\" with latch \"" << latchName(variant, latch) << "\"" << std::endl;
+  std::cerr << "Topology: " << numa.topology.describe() << std::endl;
+  [[maybe_unused]] double time = runBenchmark(file, num_threads, task_factor, variant, latch, grouped, checkRounds, latencySampling, RunConfig(), numa).front();
+#if LCT_STATS
+  // The counters of the benchmarked run, as JSON on stdout.
+  auto stats = CountingStats::collect();
+  if (stats[kReprWalks])
+    std::cerr << "getRepr: " << stats[kReprWalks] << " walks, " << static_cast<double>(stats[kReprHops]) / stats[kReprWalks] << " hops/walk (π-array only: " << static_cast<double>(stats[kChainHops]) / stats[kReprWalks] << " hops/walk)" << std::endl;
+  std::cout << "{\"workload\": \"" << type << "\", \"variant\": " << variant << ", \"latch\": \"" << latchName(variant, latch) << "\", \"threads\": " << num_threads << ", \"time_ms\": " << time << ", \"stats\": " << stats.toJson() << "}" << std::endl;
+#endif
 }
 
-void benchmark(std::string filename, unsigned num_threads, unsigned task_factor, unsigned lock_coupling = 0) { 
-  auto tokenize = [&]() -> std::vector<std::string> {
-    auto pos = filename.find_last_of("/");
-    auto tmp = filename.substr(1 + pos, filename.size());
-    std::vector<std::string> tokens;
-    pos = 0;
-    for (std::string delimiter = "-"; (pos = tmp.find(delimiter)) != std::string::npos; tmp.erase(0, pos + 1))
-      tokens.push_back(tmp.substr(0, pos));
-    tokens.push_back(tmp);
-    return std::move(tokens);
-  };
+void sweep(std::string filename, const std::vector<unsigned>& threads, const std::vector<unsigned>& taskFactors, const std::vector<unsigned>& variants, std::string latch, const RunConfig& runs, unsigned checkRounds, ReportWriter::Format format) {
+// Benchmark all combinations of `variants`, `threads` and `taskFactors` on the workload, which is opened once.
+// Each combination is one row on stdout, with the summary of its measured runs and the metadata of the build and the machine.
+  std::cerr << "Start loading workload.." << std::endl;
+  WorkloadFile file(filename);
+  openWorkload(file, filename);
+  auto& header = file.header();
+  uint64_t numOps = 0;
+  for (auto count : header.opCounts)
+    numOps += count;
 
-  auto tokens = tokenize();
-  auto type = tokens.front();
-  auto w = tokens[1];
-  auto b = tokens[tokens.size() - 2];
-  auto n = atoi(tokens.back().substr(0, tokens.back().find_last_of(".")).data());
-
-  std::cerr << "Start benchmarking \"" << type << " (" << std::to_string(n) << ")\"" << std::endl;
-  double time = 0;
-  if (type == "cut") {
-    time = cut_benchmark(filename, n, num_threads, task_factor, lock_coupling);
-  } else if (type == "lookup") {
-    time = lookup_benchmark(filename, n, num_threads, task_factor, lock_coupling);
-  } else {
-    std::cerr << "Not supported yet!" << std::endl;
+  RunMetadata metadata;
+  NumaConfig numa;
+  ReportWriter writer(std::cout, format);
+  std::cerr << "Sweep \"" << workloadName(header) << " (n=" << header.n << ", " << header.treeType() << ", β=" << header.batchSize << ")\" at revision " << metadata.revision << " on " << metadata.cpu << std::endl;
+  for (auto variant : variants) {
+    for (auto numThreads : threads) {
+      for (auto taskFactor : taskFactors) {
+        std::cerr << "---------------- Sweep: variant=" << variantName(variant) << ", threads=" << numThreads << ", task_factor=" << taskFactor << " ----------------" << std::endl;
+        auto times = runBenchmark(file, numThreads, taskFactor, variant, latch, false, checkRounds, 0, runs, numa);
+        auto summary = RunSummary::of(times);
+        writer.write({
+          ReportWriter::text("revision", metadata.revision),
+          ReportWriter::text("compiler", metadata.compiler),
+          ReportWriter::text("flags", metadata.flags),
+          ReportWriter::text("cpu", metadata.cpu),
+          ReportWriter::text("workload", filename),
+          ReportWriter::text("kind", workloadName(header)),
+          ReportWriter::number("n", header.n),
+          ReportWriter::text("tree", header.treeType()),
+          ReportWriter::number("batch_size", header.batchSize),
+          ReportWriter::number("ops", numOps),
+          ReportWriter::text("variant", variantName(variant)),
+          ReportWriter::text("latch", latchName(variant, latch)),
+          ReportWriter::number("threads", numThreads),
+          ReportWriter::number("task_factor", taskFactor),
+          ReportWriter::text("schedule", "slices"),
+          ReportWriter::text("pinning", pinningName(numa.pinning)),
+          ReportWriter::text("placement", placementName(numa.placement)),
+          ReportWriter::number("warmup", runs.warmup),
+          ReportWriter::number("repetitions", runs.repetitions),
+          ReportWriter::number("median_ms", summary.median),
+          ReportWriter::number("mean_ms", summary.mean),
+          ReportWriter::number("stddev_ms", summary.stddev),
+          ReportWriter::number("min_ms", summary.min),
+          ReportWriter::number("ops_per_s", summary.median ? numOps / (summary.median / 1000) : 0)
+        });
+      }
+    }
+  }
+}
+
+std::vector<unsigned> parseList(const std::string& list, const char* name, unsigned minimum) {
+// Parse a comma-separated list of numbers of at least `minimum`, e.g., "2,4,8".
+  std::vector<unsigned> values;
+  std::istringstream in(list);
+  for (std::string item; std::getline(in, item, ',');) {
+    if (item.empty() || (item.find_first_not_of("0123456789") != std::string::npos) || (static_cast<unsigned>(atoi(item.c_str())) < minimum)) {
+      std::cerr << "The " << name << " \"" << list << "\" must be a list of numbers of at least " << minimum << "!" << std::endl;
+      exit(-1);
+    }
+    values.push_back(atoi(item.c_str()));
+  }
+  if (values.empty()) {
+    std::cerr << "The " << name << " must not be empty!" << std::endl;
     exit(-1);
   }
+  return values;
+}
+
+int sweepMain(int argc, char** argv) {
+// The sweep mode: `concurrent_bench sweep ...`.
+  if ((argc < 5) || (argc > 11)) {
+    std::cerr << "Usage: " << argv[0] << " sweep <workload:file> <threads:list> <task_factors:list> [<variants:list[0=fine-grained,1=lock-coupling,2=coarse]>] [<latch:string[mutex,ttas,mcs]>] [<warmup:unsigned>] [<repetitions:unsigned>] [<check_rounds:unsigned>] [<format:string[csv,json]>]" << std::endl;
+    exit(-1);
+  }
+  auto threads = parseList(argv[3], "thread counts", 1);
+  auto taskFactors = parseList(argv[4], "task factors", 1);
+  auto variants = (argc >= 6) ? parseList(argv[5], "variants", 0) : std::vector<unsigned>{kFineGrained};
+  for (auto variant : variants) {
+    if (variant > kCoarse) {
+      std::cerr << "Variant " << variant << " not yet supported!" << std::endl;
+      exit(-1);
+    }
+  }
+  std::string latch = (argc >= 7) ? argv[6] : "mutex";
+  if ((argc >= 7) && (std::find(variants.begin(), variants.end(), kCoarse) != variants.end()))
+    warnIgnoredLatch(latch);
+  RunConfig runs;
+  runs.warmup = (argc >= 8) ? atoi(argv[7]) : 1;
+  runs.repetitions = (argc >= 9) ? atoi(argv[8]) : 5;
+  if (!runs.repetitions) {
+    std::cerr << "A sweep needs at least one repetition!" << std::endl;
+    exit(-1);
+  }
+  unsigned checkRounds = (argc >= 10) ? atoi(argv[9]) : 1;
+  std::string format = (argc == 11) ? argv[10] : "csv";
+  if ((format != "csv") && (format != "json")) {
+    std::cerr << "Format \"" << format << "\" not yet supported!" << std::endl;
+    exit(-1);
+  }
+  sweep(argv[2], threads, taskFactors, variants, latch, runs, checkRounds, (format == "csv") ? ReportWriter::kCsv : ReportWriter::kJson);
+  return 0;
 }
 
 int main(int argc, char** argv) {
-  if ((argc != 4) && (argc != 5)) {
-    std::cerr << "Usage: " << argv[0] << " <workload:file> <num_threads:unsigned> <task_factor:unsigned> [<lock-coupling:bool>]" << std::endl;
+  if ((argc >= 2) && (std::string(argv[1]) == "sweep"))
+    return sweepMain(argc, argv);
+  if ((argc < 4) || (argc > 11)) {
+    std::cerr << "Usage: " << argv[0] << " <workload:file> <num_threads:unsigned> <task_factor:unsigned> [<variant:unsigned[0=fine-grained,1=lock-coupling,2=coarse]>] [<latch:string[mutex,ttas,mcs]>] [<schedule:string[slices,grouped]>] [<pinning:string[none,compact,scatter]>] [<placement:string[default,first-touch,interleave]>] [<check_rounds:unsigned>] [<latency_sampling:unsigned>]" << std::endl;
+    exit(-1);
+  }
+  unsigned variant = (argc >= 5) ? atoi(argv[4]) : static_cast<unsigned>(kFineGrained);
+  if (variant > kCoarse) {
+    std::cerr << "Variant " << variant << " not yet supported!" << std::endl;
+    exit(-1);
+  }
+  auto latch = (argc >= 6) ? argv[5] : "mutex";
+  if ((argc >= 6) && (variant == kCoarse))
+    warnIgnoredLatch(latch);
+  std::string schedule = (argc >= 7) ? argv[6] : "slices";
+  if ((schedule != "slices") && (schedule != "grouped")) {
+    std::cerr << "Schedule \"" << schedule << "\" not yet supported!" << std::endl;
     exit(-1);
   }
-  auto lock_coupling = (argc == 5) ? atoi(argv[4]) : 0;
-  benchmark(argv[1], atoi(argv[2]), atoi(argv[3]), lock_coupling);
-}
\ No newline at end of file
+  if ((schedule == "grouped") && (variant == kCoarse)) {
+    std::cerr << "The coarse variant has no batch API!" << std::endl;
+    exit(-1);
+  }
+
+  NumaConfig numa;
+  std::string pinning = (argc >= 8) ? argv[7] : "none";
+  if (pinning == "compact") {
+    numa.pinning = PinPolicy::kCompact;
+  } else if (pinning == "scatter") {
+    numa.pinning = PinPolicy::kScatter;
+  } else if (pinning != "none") {
+    std::cerr << "Pinning \"" << pinning << "\" not yet supported!" << std::endl;
+    exit(-1);
+  }
+  std::string placement = (argc >= 9) ? argv[8] : "default";
+  if (placement == "first-touch") {
+    numa.placement = Placement::kFirstTouch;
+    if (numa.pinning == PinPolicy::kNone)
+      std::cerr << "Warning: first-touch placement without pinning, the workers may migrate between NUMA nodes." << std::endl;
+  } else if (placement == "interleave") {
+    numa.placement = Placement::kInterleave;
+    if (!numa.topology.setInterleave(true)) {
+      std::cerr << "Warning: the kernel refused to interleave, falling back to the default placement." << std::endl;
+      numa.placement = Placement::kDefault;
+      placement = "default";
+    }
+    numa.topology.setInterleave(false);
+  } else if (placement != "default") {
+    std::cerr << "Placement \"" << placement << "\" not yet supported!" << std::endl;
+    exit(-1);
+  }
+  std::cerr << "NUMA: pinning=" << pinning << ", placement=" << placement << std::endl;
+
+  // The rounds of the correctness check, each a full run whose lookups are compared with the roots stored in the workload.
+  unsigned checkRounds = (argc >= 10) ? atoi(argv[9]) : 10;
+
+  // Time every `latencySampling`-th operation of each worker, if any. The grouped schedule runs whole batches inside the trees.
+  unsigned latencySampling = (argc == 11) ? atoi(argv[10]) : 0;
+  if (latencySampling && (schedule == "grouped")) {
+    std::cerr << "The grouped schedule has no per-operation latencies!" << std::endl;
+    exit(-1);
+  }
+  benchmark(argv[1], atoi(argv[2]), atoi(argv[3]), variant, latch, schedule == "grouped", checkRounds, latencySampling, numa);
+}
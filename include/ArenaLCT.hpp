@@ -0,0 +1,182 @@
+#ifndef ARENA_LCT_HPP
+#define ARENA_LCT_HPP
+#include <assert.h>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Arena-backed variant of `LinkCutTree`.
+// The nodes are owned by the tree and addressed by their 32-bit index, i.e., the vertex label.
+// The links are kept in a structure-of-arrays layout: `left_`, `right_`, `parent_` and `revert_` are separate arrays.
+// Thus, a node costs 13 bytes instead of the 40 bytes of a heap-allocated `LinkCutTree::Node`.
+// The conventions (`left` points to the deeper part of the preferred path) and the operations, including `evert`
+// with lazy reversal, are the ones of `LinkCutTree`, so that the layouts run the same algorithm.
+class ArenaLinkCutTree {
+public:
+  using Index = uint32_t;
+
+  // The null index.
+  static constexpr Index nil = std::numeric_limits<Index>::max();
+
+  explicit ArenaLinkCutTree(unsigned n) : left_(n, nil), right_(n, nil), parent_(n, nil), revert_(n, false)
+  // The constructor.
+  {
+    assert(n < nil);
+  }
+
+  // The number of nodes.
+  unsigned size() const { return parent_.size(); }
+
+  void link(Index x, Index y) {
+    assert(findRoot(x) != findRoot(y));
+
+    // Make `x` the root of its tree, so that it can be linked. `evert` exposes `x` first.
+    evert(x);
+    push(x);
+    assert(right_[x] == nil);
+    parent_[x] = y;
+  }
+
+  void evert(Index x) {
+    // Make `x` the root of its tree by reversing the path from the root to `x`.
+    expose(x);
+    revert_[x] ^= true;
+  }
+
+  void cut(Index x) {
+    // Delete `x` from its parent.
+    expose(x);
+    assert(right_[x] != nil);
+    parent_[right_[x]] = nil;
+    right_[x] = nil;
+  }
+
+  Index findRoot(Index x) {
+    // Find the root `r` of `x`.
+    expose(x);
+    while (right_[x] != nil) {
+      x = right_[x];
+      push(x);
+    }
+
+    // Amortized cost.
+    splay(x);
+    return x;
+  }
+
+  Index lca(Index x, Index y) {
+    assert(findRoot(x) == findRoot(y));
+    expose(x);
+    return expose(y);
+  }
+
+  bool areConnected(Index x, Index y) {
+    return findRoot(x) == findRoot(y);
+  }
+
+private:
+  // The left children.
+  std::vector<Index> left_;
+  // The right children.
+  std::vector<Index> right_;
+  // The parents, overloaded with the path-parent pointers (see `LinkCutTree::Node::isRoot`).
+  std::vector<Index> parent_;
+  // Whether the children of all nodes in the splay subtree are to be swapped (lazy reversal).
+  std::vector<uint8_t> revert_;
+  // The stack of `pushDown`.
+  std::vector<Index> pushStack_;
+
+  bool isRoot(Index x) const {
+    auto p = parent_[x];
+    return (p == nil) || ((left_[p] != x) && (right_[p] != x));
+  }
+
+public:
+  // The primitives are public, as in `LinkCutTree`, e.g., for `lct_microbench`.
+  // Applies a pending reversal of `x` to its children. See `LinkCutTree::push`.
+  void push(Index x) {
+    if (revert_[x]) {
+      std::swap(left_[x], right_[x]);
+      if (left_[x] != nil)
+        revert_[left_[x]] ^= true;
+      if (right_[x] != nil)
+        revert_[right_[x]] ^= true;
+      revert_[x] = false;
+    }
+  }
+
+  // Pushes the pending reversals on the way from the root of the splay tree down to `x`. See `LinkCutTree::pushDown`.
+  void pushDown(Index x) {
+    // Most splay trees are not reversed, so check first.
+    bool pending = revert_[x];
+    for (Index y = x; !pending && !isRoot(y); y = parent_[y])
+      pending = revert_[parent_[y]];
+    if (!pending)
+      return;
+
+    pushStack_.clear();
+    for (Index y = x; !isRoot(y); y = parent_[y])
+      pushStack_.push_back(parent_[y]);
+    for (unsigned index = pushStack_.size(); index != 0; --index)
+      push(pushStack_[index - 1]);
+    push(x);
+  }
+
+  // Rotates edge (`x`, `x.parent`). See `LinkCutTree::rotate`.
+  void rotate(Index x) {
+    Index p = parent_[x];
+    Index g = parent_[p];
+    bool isPRoot = isRoot(p);
+    bool isXLeftChild = (x == left_[p]);
+
+    // Create 3 edges: (x.r(l), p), (p, x) and (x, g)
+    if (isXLeftChild) {
+      Index c = right_[x];
+      if (c != nil)
+        parent_[c] = p;
+      left_[p] = c;
+      right_[x] = p;
+    } else {
+      Index c = left_[x];
+      if (c != nil)
+        parent_[c] = p;
+      right_[p] = c;
+      left_[x] = p;
+    }
+
+    parent_[p] = x;
+    parent_[x] = g;
+    if (!isPRoot) {
+      if (p == left_[g])
+        left_[g] = x;
+      else
+        right_[g] = x;
+    }
+  }
+
+  // Brings `x` to the root of its splay tree. See `LinkCutTree::splay`.
+  void splay(Index x) {
+    pushDown(x);
+    while (!isRoot(x)) {
+      Index p = parent_[x];
+      if (!isRoot(p)) {
+        Index g = parent_[p];
+        rotate(((x == left_[p]) == (p == left_[g])) ? p /* zig-zig case */ : x /* zig-zag case */);
+      }
+      rotate(x);
+    }
+  }
+
+  Index expose(Index x) {
+    Index last = nil;
+    for (Index y = x; y != nil; y = parent_[y]) {
+      splay(y);
+      left_[y] = last;
+      last = y;
+    }
+    splay(x);
+    return last;
+  }
+};
+#endif
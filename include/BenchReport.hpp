@@ -0,0 +1,148 @@
+#ifndef BENCH_REPORT_HPP
+#define BENCH_REPORT_HPP
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The git revision and the compiler flags are generated by CMake, see `cmake/BuildInfo.cmake`.
+#if __has_include("BuildInfo.hpp")
+#include "BuildInfo.hpp"
+#endif
+#ifndef LCT_GIT_REVISION
+#define LCT_GIT_REVISION "unknown"
+#endif
+#ifndef LCT_CXX_FLAGS
+#define LCT_CXX_FLAGS "unknown"
+#endif
+
+// Where and how a benchmark ran, reported with each row, so that results can be compared over time.
+struct RunMetadata {
+  std::string revision = LCT_GIT_REVISION;
+  std::string compiler =
+#ifdef __clang__
+    "clang " __clang_version__;
+#else
+    "gcc " __VERSION__;
+#endif
+  std::string flags = LCT_CXX_FLAGS;
+  std::string cpu = cpuModel();
+
+  static std::string cpuModel() {
+  // The model of the CPU, as reported by `/proc/cpuinfo`.
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (std::string line; std::getline(cpuinfo, line);) {
+      if (line.rfind("model name", 0) != 0)
+        continue;
+      auto colon = line.find(':');
+      if (colon != std::string::npos)
+        return line.substr(line.find_first_not_of(" \t", colon + 1));
+    }
+    return "unknown";
+  }
+};
+
+// The summary of the times of repeated runs, in milliseconds.
+struct RunSummary {
+  double median = 0;
+  double mean = 0;
+  // The sample standard deviation.
+  double stddev = 0;
+  double min = 0;
+
+  static RunSummary of(std::vector<double> times) {
+    RunSummary summary;
+    if (times.empty())
+      return summary;
+    std::sort(times.begin(), times.end());
+    auto size = times.size();
+    summary.median = (size % 2) ? times[size / 2] : (times[size / 2 - 1] + times[size / 2]) / 2;
+    summary.min = times.front();
+    for (auto time : times)
+      summary.mean += time;
+    summary.mean /= size;
+    if (size > 1) {
+      for (auto time : times)
+        summary.stddev += (time - summary.mean) * (time - summary.mean);
+      summary.stddev = std::sqrt(summary.stddev / (size - 1));
+    }
+    return summary;
+  }
+};
+
+// Writes rows of named fields, either as CSV with a header line or as JSON lines, i.e., one object per row.
+class ReportWriter {
+public:
+  enum Format {
+    kCsv,
+    kJson
+  };
+
+  // A field: its name and its value, which is quoted if `text`.
+  struct Field {
+    std::string name;
+    std::string value;
+    bool text;
+  };
+
+  ReportWriter(std::ostream& out, Format format)
+  // The constructor.
+  : out_(out), format_(format) {}
+
+  static Field text(std::string name, std::string value) { return {std::move(name), std::move(value), true}; }
+
+  template <class T>
+  static Field number(std::string name, T value) {
+    std::ostringstream out;
+    if constexpr (std::is_floating_point_v<T>)
+      out << std::fixed << std::setprecision(3);
+    out << value;
+    return {std::move(name), out.str(), false};
+  }
+
+  void write(const std::vector<Field>& row) {
+  // Write `row`. The first row of a CSV also writes the header, so all rows should have the same fields.
+    if (format_ == kCsv) {
+      if (!wroteHeader_) {
+        for (unsigned index = 0; index != row.size(); ++index)
+          out_ << (index ? "," : "") << row[index].name;
+        out_ << std::endl;
+        wroteHeader_ = true;
+      }
+      for (unsigned index = 0; index != row.size(); ++index)
+        out_ << (index ? "," : "") << (row[index].text ? quote(row[index].value, "\"\"") : row[index].value);
+    } else {
+      out_ << "{";
+      for (unsigned index = 0; index != row.size(); ++index)
+        out_ << (index ? ", " : "") << quote(row[index].name, "\\\"") << ": " << (row[index].text ? quote(row[index].value, "\\\"") : row[index].value);
+      out_ << "}";
+    }
+    out_ << std::endl;
+  }
+
+private:
+  static std::string quote(const std::string& value, const char* escapedQuote) {
+  // Quote `value`, replacing the quotes inside with `escapedQuote`. In JSON, backslashes are escaped as well.
+    std::string result = "\"";
+    for (auto c : value) {
+      if (c == '"')
+        result += escapedQuote;
+      else if ((c == '\\') && (escapedQuote[0] == '\\'))
+        result += "\\\\";
+      else
+        result += c;
+    }
+    return result + "\"";
+  }
+
+  std::ostream& out_;
+  Format format_;
+  bool wroteHeader_ = false;
+};
+#endif
@@ -1,213 +1,206 @@
-#ifndef PLCT_HPP
-#define PLCT_HPP
+#ifndef COARSE_LCT_HPP
+#define COARSE_LCT_HPP
 #include <assert.h>
-#include <iostream>
 #include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
 
-#define DEBUG 0
-
-// Inspired from: https://github.com/indy256/codelibrary/blob/master/java/structures/LinkCutTree.java
-class ParallelLinkCutTree {
+// Coarse-grained baseline for `ConcurrentLinkCutTrees`: a single readers-writer latch guards the whole forest.
+// `link` and `cut` take it exclusively. `findRoot` takes it shared and walks to the root without restructuring;
+// only if the walk gets too long, it retakes the latch exclusively and exposes the node, so that the splay trees are rebalanced.
+// The API and the conventions (`left` points towards the root, `link` everts with lazy reversal) are the ones of `ConcurrentLinkCutTrees`.
+template <class SharedLatch = std::shared_mutex>
+class CoarseLinkCutTrees {
 public:
-  class Node {
-    friend class ParallelLinkCutTree;
-    Node* left = nullptr;
-    Node* right = nullptr;
-    Node* parent = nullptr;
-    bool revert;
-    
+  class CoNode {
+    friend class CoarseLinkCutTrees;
+    // The left child.
+    CoNode* left = nullptr;
+    // The right child.
+    CoNode* right = nullptr;
+    // The parent.
+    CoNode* parent = nullptr;
+    // Whether the children of all nodes in the splay subtree are to be swapped (lazy reversal).
+    bool revert = false;
+
     bool isRoot() {
-      // The first check refers to general root.
-      // The second check refers to a local root.
-      // Thus, `parent` is overloaded by the parent pointer in the actual tree.
-      // It represents at the same the parent within a splay tree and the parent pointer in the actual tree.
-      return (parent == nullptr) || ((parent->left != this) && (parent->right != this));
+      // See `ConcurrentLinkCutTrees::CoNode::isRoot`.
+      return (parent == nullptr) || ((parent->right != this) && (parent->left != this));
     }
   public:
-    uint64_t value;
+    // The label.
+    unsigned label;
   };
 
+  // The maximal number of nodes a shared lookup visits.
+  static constexpr unsigned kMaxSharedHops = 256;
+
+  // The nodes.
+  std::vector<CoNode*>& nodes_;
+
+  CoarseLinkCutTrees(unsigned, std::vector<CoNode*>& nodes) : nodes_(nodes)
+  // The constructor. It takes the number of nodes as `ConcurrentLinkCutTrees` does, but needs no per-node state.
+  {}
+
+  void link(CoNode* x, CoNode* y) {
+    std::unique_lock lock(latch_);
+
+    // Make `x` the root of its tree, so that it can be linked.
+    evertLocked(x);
+    assert(!x->left);
+    x->parent = y;
+  }
+
+  void evert(CoNode* x) {
+    std::unique_lock lock(latch_);
+    evertLocked(x);
+  }
+
+  void cut(CoNode* x) {
+    std::unique_lock lock(latch_);
+    expose(x);
+
+    // Delete `x` from its parent.
+    assert(!!x->left);
+    x->left->parent = nullptr;
+    x->left = nullptr;
+  }
+
+  CoNode* findRoot(CoNode* x) {
+    {
+      std::shared_lock lock(latch_);
+      if (auto root = walkToRoot(x))
+        return root;
+    }
+
+    // The walk was too long, so restructure.
+    std::unique_lock lock(latch_);
+    expose(x);
+    while (x->left) {
+      x = x->left;
+      push(x);
+    }
+
+    // Amortized cost.
+    splay(x);
+    return x;
+  }
+
 private:
-  std::mutex latch;
-     
-  void printBT(const std::string& prefix, const Node* node, bool isLeft) {
-    if (node != nullptr)
-        {
-            std::cout << prefix;
-
-            std::cout << (isLeft ? "├──" : "└──" );
-
-            // print the value of the node
-            std::cout << node->value << std::endl;
-
-            // enter the next tree level - left and right branch
-            printBT( prefix + (isLeft ? "│   " : "    "), node->left, true);
-            printBT( prefix + (isLeft ? "│   " : "    "), node->right, false);
-        }
+  // The latch.
+  SharedLatch latch_;
+  // The stack of `pushDown`. Only used under the exclusive latch.
+  std::vector<CoNode*> pushStack_;
+
+  CoNode* walkToRoot(CoNode* x) {
+  // Climb to the root of the topmost splay tree and take its leftmost node. Returns `nullptr` if the walk is too long.
+  // The walk runs under the shared latch, so it does not push the pending reversals, but tracks the orientation on the way down.
+    unsigned hops = 0;
+    while (x->parent) {
+      if (++hops == kMaxSharedHops)
+        return nullptr;
+      x = x->parent;
     }
+    bool reversed = x->revert;
+    while (CoNode* next = reversed ? x->right : x->left) {
+      if (++hops == kMaxSharedHops)
+        return nullptr;
+      x = next;
+      reversed ^= x->revert;
+    }
+    return x;
+  }
 
-    void printBT(const Node* node)
-    {
-        printBT("", node, false);    
+  // Applies a pending reversal of `x` to its children, see `ConcurrentLinkCutTrees::push`.
+  void push(CoNode* x) {
+    if (x->revert) {
+      std::swap(x->left, x->right);
+      if (x->left)
+        x->left->revert ^= true;
+      if (x->right)
+        x->right->revert ^= true;
+      x->revert = false;
     }
-  
-  // rotates edge (x, x.parent)
-  //        g            g
-  //       /            /
-  //      p            x
-  //     / \    ->    / \
-  //    x  p.r      x.l  p
-  //   / \              / \
-  // x.l x.r          x.r p.r
-  void rotate(Node* x) {
-    Node* p = x->parent;
-    Node* g = p->parent;
+  }
+
+  // Pushes the pending reversals on the way from the root of the splay tree down to `x`, see `ConcurrentLinkCutTrees::pushDown`.
+  void pushDown(CoNode* x) {
+    // Most splay trees are not reversed, so check first.
+    bool pending = x->revert;
+    for (CoNode* y = x; !pending && !y->isRoot(); y = y->parent)
+      pending = y->parent->revert;
+    if (!pending)
+      return;
+
+    pushStack_.clear();
+    for (CoNode* y = x; !y->isRoot(); y = y->parent)
+      pushStack_.push_back(y->parent);
+    for (unsigned index = pushStack_.size(); index != 0; --index)
+      push(pushStack_[index - 1]);
+    push(x);
+  }
+
+  // Rotates edge (`x`, `x.parent`), see `ConcurrentLinkCutTrees::rotate`.
+  void rotate(CoNode* x) {
+    CoNode* p = x->parent;
+    CoNode* g = p->parent;
     bool isPRoot = p->isRoot();
-    bool isXLeftChild = (x == p->left);
-    
+    bool isXRightChild = (x == p->right);
+
     // Create 3 edges: (x.r(l), p), (p, x) and (x, g)
-    if (isXLeftChild) {
-      if (x->right)
-        x->right->parent = p;
-      p->left = x->right;
-    } else {
+    if (isXRightChild) {
       if (x->left)
         x->left->parent = p;
       p->right = x->left;
+    } else {
+      if (x->right)
+        x->right->parent = p;
+      p->left = x->right;
     }
-    
+
     p->parent = x;
-    if (!isXLeftChild)
-      x->left = p;
-    else
+    if (!isXRightChild)
       x->right = p;
+    else
+      x->left = p;
     x->parent = g;
     if (!isPRoot) {
-      if (p == g->left)
-        g->left = x;
-      else
+      if (p == g->right)
         g->right = x;
+      else
+        g->left = x;
     }
   }
-  
-  // brings x to the root, balancing tree
-  //
-  // zig-zig case
-  //        g                                  x
-  //       / \               p                / \
-  //      p  g.r rot(p)    /   \     rot(x) x.l  p
-  //     / \      -->    x       g    -->       / \
-  //    x  p.r          / \     / \           x.r  g
-  //   / \            x.l x.r p.r g.r             / \
-  // x.l x.r                                    p.r g.r
-  //
-  // zig-zag case
-  //      g               g
-  //     / \             / \               x
-  //    p  g.r rot(x)   x  g.r rot(x)    /   \
-  //   / \      -->    / \      -->    p       g
-  // p.l  x           p  x.r          / \     / \
-  //     / \         / \            p.l x.l x.r g.r
-  //   x.l x.r     p.l x.l
-  void splay(Node* x) {
-#if DEBUG
-    std::cerr << "\t[splay start] node=" << x->value << std::endl;
-#endif
-    while (!x->isRoot()) { 
-      Node* p = x->parent;
-      Node* g = p->parent;
-#if DEBUG
-      std::cerr << "\t\t[splay-inside] p=" << p->value << std::endl;
-      std::cerr << "\t\t[splay-inside] parent before rotation" << std::endl;
-      printBT(p);
-#endif
+
+  // Brings `x` to the root, balancing the tree, see `ConcurrentLinkCutTrees::splay`.
+  void splay(CoNode* x) {
+    pushDown(x);
+    while (!x->isRoot()) {
+      CoNode* p = x->parent;
+      CoNode* g = p->parent;
       if (!p->isRoot()) {
-        rotate(((x == p->left) == (p == g->left)) ? p /* zig-zig case */ : x /* zig-zag case */);
+        rotate(((x == p->right) == (p == g->right)) ? p /* zig-zig case */ : x /* zig-zag case */);
       }
       rotate(x);
-#if DEBUG
-      std::cerr << "\t\t[splay-inside] after rotation:" << std::endl;
-      printBT(x);
-#endif
     }
-#if DEBUG
-    std::cerr << "\t[splay finish]" << std::endl;
-#endif
   }
-  
-  Node* expose(Node* x) {
-    Node* last = nullptr;
-#if DEBUG
-    std::cerr << "[expose] x=" << x->value << std::endl;
-#endif
-    for (Node* y = x; y; y = y->parent) {
-#if DEBUG
-      std::cerr << "[expose] splay y=" << y->value << " parent=" << (y->parent ? std::to_string(y->parent->value) : "nullptr") << std::endl;
-#endif
+
+  void expose(CoNode* x) {
+  // Make the path from the root to `x` preferred. The caller holds the latch exclusively.
+    CoNode* last = nullptr;
+    for (CoNode* y = x; y; last = y, y = y->parent) {
       splay(y);
-      y->left = last;
-      last = y;
+      y->right = last;
     }
-    // This splay can be also done by rotating `x` in each iteration.
-    // TOode=7DO: maybe better for prl!
-#if DEBUG
-    std::cerr << "[expose] last splay x=" << x->value << std::endl;
-#endif
     splay(x);
-    return last;
-  }
-  
-public:
-  void link(Node* x, Node* y) {
-    std::unique_lock lock(latch);
-    auto rx = findRoot(x), ry = findRoot(y);
-    //assert(rx != ry);
-    if (rx == ry) {
-      return;
-    }
-#if DEBUG
-    std::cerr << "%% [link] x=" << x->value << " y=" << y->value << std::endl;
-#endif
-    expose(x);
-    
-#if DEBUG
-    printBT(x);
-    printBT(y);
-#endif
-    
-    // TODO: what if x or y are erased?
-    // x must be a root node.
-    assert(!x->right);
-    x->parent = y;
-  }
-  
-  void cut(Node* x) {
-    // Delete `v` from its parent.
-    expose(x);
-    assert(!!x->right);
-    x->right->parent = nullptr;
-    x->right = nullptr;
   }
-  
-  Node* findRoot(Node* x) {
-#if DEBUG
-    std::cerr << "&&& [findRoot] x=" << x->value << std::endl;
-#endif
-    // Find the root `r` of `v`.
+
+  void evertLocked(CoNode* x) {
+  // Make `x` the root of its tree by reversing the path from the root to `x`. The caller holds the latch exclusively.
     expose(x);
-    while (x->right) x = x->right;
-    
-    // Amortized cost.
-#if DEBUG
-    std::cerr << "+++ [findRoot] final splay x=" << x->value << std::endl;
-#endif
-    splay(x);
-    return x;
-  }
-  
-  bool areConnected(Node* x, Node* y) {
-    std::unique_lock lock(latch);
-    return findRoot(x) == findRoot(y);
+    x->revert = !x->revert;
+    push(x);
   }
 };
 #endif
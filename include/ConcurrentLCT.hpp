@@ -1,20 +1,60 @@
+#ifndef CONCURRENT_LCT_HPP
+#define CONCURRENT_LCT_HPP
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "InlineVector.hpp"
+#include "Monoids.hpp"
+#include "RelaxedAtomic.hpp"
+#include "Stats.hpp"
+#include "WorkerPool.hpp"
 
 // `Concurrent Link-Cut Trees` - Mihail Stoian, 2021.
 // The implementation is adapted from: https://github.com/indy256/codelibrary/blob/master/java/structures/LinkCutTree.java.
+// The latches are of type `Latch`, see `Latches.hpp` for the available policies.
+// With `kLockCoupling`, `pathExpose` latches hand-over-hand, see `LockCouplingLCT.hpp`.
+// Path aggregates are maintained for `Monoid`, see `Monoids.hpp`.
+// The hot paths, e.g., the splays, the chains walked and the latches, are counted by `Stats`, see `Stats.hpp`.
+// With `kShortcuts`, `getRepr` jumps over long π-array chains with stamped shortcuts, see `depthInPath`.
+// They cost about 40 bytes per node and only pay off on deep preferred paths, so they are off by default.
+// The benchmarks enable them with the CMake option `LCT_SHORTCUTS`.
+// Batches of operations can be scheduled on a `WorkerPool` by `linkBatch`, `cutBatch` and `findRootBatch`.
+#ifndef LCT_SHORTCUTS
+#define LCT_SHORTCUTS 0
+#endif
+
+template <class Latch = std::mutex, bool kLockCoupling = false, class Monoid = NoAggregate, class Stats = NoStats, bool kShortcuts = false>
 class ConcurrentLinkCutTrees {
+  static_assert(isCommutative<Monoid>, "`evert` does not mirror the aggregates, so the monoid has to be commutative, see `Monoids.hpp`.");
+
 public:
-  class CoNode {
+  class CoNode : public AggregateSlot<Monoid> {
     friend class ConcurrentLinkCutTrees;
+    // The links are written under the latch of the preferred path, but read by optimistic lookups.
+    // Thus, they are atomics with relaxed ordering, see `RelaxedAtomic.hpp`.
     // The left child.
-    CoNode* left = nullptr;
+    RelaxedAtomic<CoNode*> left = nullptr;
     // The right child.
-    CoNode* right = nullptr;
+    RelaxedAtomic<CoNode*> right = nullptr;
     // The parent.
-    CoNode* parent = nullptr;
+    RelaxedAtomic<CoNode*> parent = nullptr;
     // The latch.
-    std::mutex latch;
+    Latch latch;
+    // Whether the children of all nodes in the splay subtree are to be swapped (lazy reversal).
+    // It is written under the latch of the preferred path.
+    RelaxedAtomic<bool> revert = false;
+    // The version of the preferred path represented by this node.
+    // It is odd while a writer holds `latch` (seqlock-style), see `tryFindRoot`.
+    std::atomic<unsigned> version = 0;
     
     bool isRoot() {
       // The first check is referring to the general root.
@@ -28,17 +68,124 @@ public:
     unsigned label;
   };
 
-  // The π-array.
-  std::vector<unsigned> pi_;
+  // The maximal number of preferred paths an optimistic lookup validates.
+  static constexpr unsigned kMaxOptimisticPaths = 64;
+  // The maximal number of nodes an optimistic lookup visits.
+  // Lookups which exceed it take the latches, so that the splay trees are rebalanced.
+  static constexpr unsigned kMaxOptimisticHops = 256;
+  // The number of buckets per task, in which a batch is grouped, see `runGrouped`.
+  static constexpr unsigned kBucketsPerTask = 8;
+
+  // The number of depth classes of the shortcuts: 0, [1, 4), [4, 16), ..., [4^6, ∞).
+  static constexpr unsigned kDepthClasses = 8;
+  // The number of bits of a label in a shortcut. The remaining ones hold the depth class.
+  static constexpr unsigned kLabelBits = 29;
+
+  // The number of latches a trace stores inline, before it allocates.
+  static constexpr unsigned kInlineTrace = 32;
+
+  // The latches taken by `pathExpose`, as representatives.
+  using Trace = InlineVector<unsigned, kInlineTrace>;
+
+  // An operation of a batch: the labels of the node and, for `link`, of its new parent.
+  using Operation = std::pair<unsigned, unsigned>;
+
+  // The π-array. It is written under the latches, but read by `getRepr` without, so its entries are published, see `unlinkInPiArray`.
+  // Its storage is allocated without being touched, so that the pages land on the NUMA node of the thread which initializes them.
+  struct RawDelete {
+    void operator()(void* data) const { ::operator delete(data); }
+  };
+  std::unique_ptr<PublishedAtomic<unsigned>[], RawDelete> pi_;
+  // The remaining arrays are only allocated with `kShortcuts`.
+  // The shortcuts of the π-array: a representative, the depth class of the node in its preferred path,
+  // and the stamp of that class when the shortcut was installed, see `packShortcut`.
+  std::vector<std::atomic<uint64_t>> shortcuts_;
+  // The stamps of the representatives, `kDepthClasses` per node. A stamp is bumped whenever the nodes of its class
+  // may have left the preferred path, i.e., on a split at or above the class, or when the node stops being a representative.
+  std::vector<std::atomic<unsigned>> stamps_;
+  // The depth of each node in its preferred path at the time its shortcut was installed. Only accessed under the latch.
+  std::vector<unsigned> depths_;
+  // The depth classes of each representative for which shortcuts were installed since their stamps were last bumped.
+  // Only accessed under the latch, see `markSplit`.
+  std::vector<uint8_t> shortcutClasses_;
   // The nodes.
   std::vector<CoNode*>& nodes_;
   
-  ConcurrentLinkCutTrees(unsigned n, std::vector<CoNode*>& nodes) : nodes_(nodes)
-  // The constructor.
+  ConcurrentLinkCutTrees(unsigned n, std::vector<CoNode*>& nodes, WorkerPool* pool = nullptr)
+  // The constructor. With `pool`, each worker initializes the π-array of a contiguous range of labels,
+  // i.e., the same partition as the nodes allocated with first-touch placement (see `concurrent_bench`).
+  : pi_(static_cast<PublishedAtomic<unsigned>*>(::operator new(sizeof(PublishedAtomic<unsigned>) * n))), nodes_(nodes)
   {
-    pi_.resize(n);
-    for (unsigned index = 0; index != n; ++index)
-      pi_[index] = index;
+    auto initPi = [&](uint64_t lb, uint64_t ub) {
+      for (uint64_t index = lb; index != ub; ++index)
+        new (&pi_[index]) PublishedAtomic<unsigned>(index);
+    };
+    if (pool && pool->size()) {
+      pool->run([&](unsigned workerId) {
+        initPi(static_cast<uint64_t>(n) * workerId / pool->size(), static_cast<uint64_t>(n) * (workerId + 1) / pool->size());
+      });
+    } else {
+      initPi(0, n);
+    }
+    if constexpr (kShortcuts) {
+      // The labels are packed into the shortcuts.
+      if (n > (1u << kLabelBits)) {
+        std::cerr << "Shortcuts support at most 2^" << kLabelBits << " nodes, not " << n << "!" << std::endl;
+        exit(-1);
+      }
+      shortcuts_ = std::vector<std::atomic<uint64_t>>(n);
+      stamps_ = std::vector<std::atomic<unsigned>>(size_t(n) * kDepthClasses);
+      depths_.resize(n);
+      shortcutClasses_.resize(n);
+      for (unsigned index = 0; index != n; ++index) {
+        // No shortcut is valid yet.
+        shortcuts_[index].store(packShortcut(index, 0, 0), std::memory_order_relaxed);
+        for (unsigned depthClass = 0; depthClass != kDepthClasses; ++depthClass)
+          stamps_[size_t(index) * kDepthClasses + depthClass].store(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void pull(CoNode* x) {
+  // Recompute the aggregate of `x` from its children.
+    if constexpr (hasAggregate<Monoid>) {
+      auto aggregate = x->weight;
+      if (x->left)
+        aggregate = Monoid::combine(x->left->aggregate, aggregate);
+      if (x->right)
+        aggregate = Monoid::combine(aggregate, x->right->aggregate);
+      x->aggregate = aggregate;
+    }
+  }
+
+  void push(CoNode* x) {
+  // Apply a pending reversal of `x` to its children.
+    if (x->revert) {
+      std::swap(x->left, x->right);
+      if (x->left)
+        x->left->revert = !x->left->revert;
+      if (x->right)
+        x->right->revert = !x->right->revert;
+      x->revert = false;
+    }
+  }
+
+  void pushDown(CoNode* x) {
+  // Push the pending reversals on the way from the root of the splay tree down to `x`.
+    // Most splay trees are not reversed, so check first.
+    bool pending = x->revert;
+    for (CoNode* y = x; !pending && !y->isRoot(); y = y->parent)
+      pending = y->parent->revert;
+    if (!pending)
+      return;
+
+    static thread_local std::vector<CoNode*> stack;
+    stack.clear();
+    for (CoNode* y = x; !y->isRoot(); y = y->parent)
+      stack.push_back(y->parent);
+    for (unsigned index = stack.size(); index != 0; --index)
+      push(stack[index - 1]);
+    push(x);
   }
 
   // Rotates edge (`x`, `x.parent`)
@@ -79,6 +226,11 @@ public:
       else
         g->left = x;
     }
+
+    // `p` is now below `x`.
+    pull(p);
+    pull(x);
+    Stats::add(kRotations);
   }
   
   // Brings `x` to the root, balancing the tree.
@@ -102,64 +254,214 @@ public:
   //   x.l x.r     p.l x.l
   void splay(CoNode* x) {
   // Splay.
+    pushDown(x);
+    uint64_t rotations = 0;
     while (!x->isRoot()) { 
       CoNode* p = x->parent;
       CoNode* g = p->parent;
       if (!p->isRoot()) {
         rotate(((x == p->right) == (p == g->right)) ? p /* zig-zig case */ : x /* zig-zag case */);
+        ++rotations;
       }
       rotate(x);
+      ++rotations;
     }
+    Stats::add(kSplays);
+    Stats::max(kMaxSplayRotations, rotations);
   }
   
   void unlinkInPiArray(unsigned c) {
   // Unlink the preferred path of `c`, whose representative is `c` itself.
+  // The caller marks the split of the path `c` was part of, see `markSplit`.
+  // The version of `c` is not bumped. Instead, the release store orders the preceding cut of the splay link before the entry:
+  // an optimistic walk which finds `c` as representative cannot follow the stale link into the upper path without entering it.
     pi_[c] = c;
   }
   
   void linkInPiArray(unsigned c, unsigned p) {
   // Link the preferred path of `c`, whose representative is `c` itself, to node `p`.
+  // `c` is no longer a representative, so all shortcuts to it are invalidated.
+    markSplit(c, 0);
     pi_[c] = p;
   }
 
+  static unsigned depthClass(unsigned depth) {
+    unsigned bits = depth ? (32 - __builtin_clz(depth)) : 0;
+    return std::min((bits + 1) / 2, kDepthClasses - 1);
+  }
+
+  static uint64_t packShortcut(unsigned repr, unsigned depthClass, unsigned stamp) {
+    return (static_cast<uint64_t>(stamp) << 32) | (depthClass << kLabelBits) | repr;
+  }
+
+  static_assert(kDepthClasses == (1u << (32 - kLabelBits)));
+
+  std::atomic<unsigned>& stamp(unsigned repr, unsigned depthClass) { return stamps_[size_t(repr) * kDepthClasses + depthClass]; }
+
+  void markSplit(unsigned repr, unsigned depth) {
+  // The nodes at `depth` and below may leave the preferred path of `repr`, so invalidate the shortcuts of their classes.
+  // Classes without shortcuts installed since their last bump have nothing to invalidate, so they are skipped.
+  // The caller holds the latch of `repr`, so there is no need for atomic increments.
+    if constexpr (!kShortcuts)
+      return;
+    auto& classes = shortcutClasses_[repr];
+    unsigned dirty = classes & ~((1u << ConcurrentLinkCutTrees::depthClass(depth)) - 1);
+    if (!dirty)
+      return;
+    classes &= ~dirty;
+    for (; dirty; dirty &= dirty - 1) {
+      auto& s = stamp(repr, __builtin_ctz(dirty));
+      s.store(s.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+  }
+
+  static unsigned shortcutRepr(uint64_t shortcut) { return static_cast<unsigned>(shortcut) & ((1u << kLabelBits) - 1); }
+
+  bool isValid(uint64_t shortcut) {
+  // Whether the node of `shortcut` is still on the preferred path of its representative.
+    auto depthClass = static_cast<unsigned>(shortcut) >> kLabelBits;
+    return stamp(shortcutRepr(shortcut), depthClass).load(std::memory_order_acquire) == (shortcut >> 32);
+  }
+
   unsigned getRepr(CoNode* node) {
   // Fetch the representative of the preferred path of `node`.
+  // Most chains have a single hop. On longer ones, each hop first tries the shortcut of the node,
+  // which leads directly to the representative. Otherwise, we follow the π-array.
     unsigned x = node->label;
-    while (x != pi_[x]) {
-      auto prev = x;
-      x = pi_[x];
+    uint64_t hops = 1;
+    for (unsigned next = pi_[x]; next != x; next = pi_[x], ++hops) {
+      if (kShortcuts && (pi_[next] != next)) {
+        auto shortcut = shortcuts_[x].load(std::memory_order_relaxed);
+        if (isValid(shortcut)) {
+          x = shortcutRepr(shortcut);
+          ++hops;
+          break;
+        }
+      }
       
       // It could be the case that it rapidly changes.
       // This can happen when we *split* the splay trees.
-      if (x == prev) return x;
+      x = next;
+    }
+    if constexpr (Stats::kEnabled) {
+      uint64_t chainHops = 1;
+      for (unsigned y = node->label; (y != pi_[y]) && (y != x); y = pi_[y])
+        ++chainHops;
+      Stats::add(kReprWalks);
+      Stats::add(kReprHops, hops);
+      Stats::add(kChainHops, chainHops);
     }
     return x;
   }
+
+  unsigned depthInPath(CoNode* node, unsigned repr) {
+  // Compute the depth of `node` in its preferred path, whose representative is `repr`.
+  // The caller holds the latch of `repr`, so the chain, the shortcuts and the stamps of `repr` are stable.
+  // The nodes on the chain are then pointed directly to `repr`, as in path compression for union-find.
+    static_assert(kShortcuts, "The depths are only needed to invalidate the shortcuts");
+    unsigned x = node->label, depth = 0;
+    while (x != repr) {
+      auto next = pi_[x];
+      if (next != repr) {
+        auto shortcut = shortcuts_[x].load(std::memory_order_relaxed);
+        if ((shortcutRepr(shortcut) == repr) && isValid(shortcut)) {
+          depth += depths_[x];
+          break;
+        }
+      }
+      x = next;
+      ++depth;
+    }
+
+    // Install the shortcuts up to the node we stopped at. Nodes at depth one are not worth it.
+    unsigned stop = x;
+    x = node->label;
+    for (unsigned remaining = depth; (x != stop) && (remaining > 1); x = pi_[x], --remaining) {
+      auto depthClass = ConcurrentLinkCutTrees::depthClass(remaining);
+      shortcutClasses_[repr] |= 1u << depthClass;
+      shortcuts_[x].store(packShortcut(repr, depthClass, stamp(repr, depthClass).load(std::memory_order_relaxed)), std::memory_order_relaxed);
+      depths_[x] = remaining;
+    }
+    return depth;
+  }
   
-  std::vector<unsigned> pathExpose(CoNode* x) {
+  void lockLatch(unsigned repr) {
+  // Lock the latch of `repr`. With statistics, it is tried first, so that the contended ones and their waits are counted.
+    auto& latch = nodes_[repr]->latch;
+    if constexpr (Stats::kEnabled) {
+      Stats::add(kLatchAcquires);
+      if (latch.try_lock())
+        return;
+      auto start = std::chrono::steady_clock::now();
+      latch.lock();
+      Stats::add(kLatchContended);
+      Stats::add(kLatchWaitNs, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    } else {
+      latch.lock();
+    }
+  }
+
+  Trace pathExpose(CoNode* x) {
+    Trace trace;
+    exposeInto<false>(x, trace, nullptr);
+    
+    // And return the trace.
+    return trace;
+  }
+
+  template <bool kTryLatch>
+  CoNode* exposeInto(CoNode* x, Trace& trace, const Trace* held) {
+  // Expose `x` and append the latches taken to `trace`. Returns the last node whose path was joined, i.e., the topmost one.
+  // The latches in `held` are already held by the caller and are skipped.
+  // With `kTryLatch`, the other latches are only tried. If one is taken, we return `nullptr`:
+  // the trees are valid, but `x` is only partially exposed, and the caller has to unlock `trace`.
     CoNode* last = nullptr;
-    std::vector<unsigned> trace;
+    unsigned lastRepr = 0;
+    bool lastAcquired = false;
     for (CoNode* y = x; y; last = y, y = y->parent) {
       unsigned repr = getRepr(y);
-      restart: {
-        nodes_[repr]->latch.lock();
+      bool acquired;
+      while (true) {
+        acquired = !held || (std::find(held->begin(), held->end(), repr) == held->end());
+        if (acquired) {
+          if constexpr (kTryLatch) {
+            if (!nodes_[repr]->latch.try_lock())
+              return nullptr;
+            Stats::add(kLatchAcquires);
+          } else {
+            lockLatch(repr);
+          }
+        }
         auto newRepr = getRepr(y);
-        if (repr != newRepr) {
+        if (repr == newRepr)
+          break;
+        if (acquired)
           nodes_[repr]->latch.unlock();
-          repr = newRepr;
-          goto restart;
-        }
-      };
+        Stats::add(kRestarts);
+        repr = newRepr;
+      }
+      if (acquired)
+        beginWrite(repr);
+
+      // The latch of `repr` is held, so shorten the chain for the next walks.
+      unsigned depth = 0;
+      if constexpr (kShortcuts)
+        depth = depthInPath(y, repr);
       
       // Splay `y`.
       splay(y);
 
       // Does it have a lower path?
+      Stats::add(kPathsJoined);
       if (y->right) {
+        Stats::add(kPathSwitches);
         // Find its representant - O(log2(n))-operation.
         auto tmp = y->right;
-        while (tmp->left)
+        push(tmp);
+        while (tmp->left) {
           tmp = tmp->left;
+          push(tmp);
+        }
         
         // Cut the link.
         auto reprOfPath = tmp->label;
@@ -168,6 +470,8 @@ public:
         // So, at a later point, a thread is able to lock it.
         // Thus, the order of instructions matters!
         y->right = nullptr;
+        if constexpr (kShortcuts)
+          markSplit(repr, depth + 1);
         unlinkInPiArray(reprOfPath);
       }
       
@@ -175,31 +479,217 @@ public:
       // The splay tree of `last` is already locked.
       // Thus, this is a safe operation. It could also be done after `link`.
       y->right = last;
+      pull(y);
       if (last) {
-        assert(!trace.empty());
-        linkInPiArray(trace.back(), y->label);
+        linkInPiArray(lastRepr, y->label);
+
+        // With lock coupling, release the lower path: it is now part of the preferred path of `repr`.
+        // A thread waiting for its latch observes the new representative and restarts.
+        if constexpr (kLockCoupling) {
+          if (lastAcquired) {
+            assert(trace.back() == lastRepr);
+            unlockPath(lastRepr);
+            trace.pop_back();
+          }
+        }
       }
       
-      trace.push_back(repr);
+      if (acquired)
+        trace.push_back(repr);
+      lastRepr = repr;
+      lastAcquired = acquired;
     }
     
     // Finally, splay `x`.
     splay(x);
-    
-    // And return the trace.
-    return std::move(trace);
+    Stats::add(kExposes);
+    return last;
+  }
+
+  template <class Fn>
+  auto exposePair(CoNode* x, CoNode* y, Fn&& fn) {
+  // Expose `x` and then `y`, so that both are exposed under the same latches, and return `fn(rootOfX, lastOfY)`.
+  // `x` is exposed as usual. While holding its trace, we only try the latches for `y`, since they may be lower
+  // in the tree than the ones held. If one is taken, we release everything and start over.
+    Trace traceX, traceY;
+    for (unsigned attempt = 0; ; ++attempt) {
+      traceX = pathExpose(x);
+      auto rootOfX = leftmost(x);
+      traceY.clear();
+      if (auto lastOfY = exposeInto<true>(y, traceY, &traceX)) {
+        auto result = fn(rootOfX, lastOfY);
+        unlockTrace(traceY);
+        unlockTrace(traceX);
+        return result;
+      }
+
+      // Back off.
+      Stats::add(kPairRetries);
+      unlockTrace(traceY);
+      unlockTrace(traceX);
+      for (unsigned index = 0; index != attempt; ++index)
+        std::this_thread::yield();
+    }
+  }
+
+  CoNode* leftmost(CoNode* x) {
+  // Find the leftmost node in the splay tree of `x`, which is the root of its splay tree.
+  // After `x` has been exposed, it is the root of the tree.
+    while (x->left) {
+      x = x->left;
+      push(x);
+    }
+    return x;
   }
   
-  void unlockTrace(std::vector<unsigned>& trace) {
+  void beginWrite(unsigned repr) {
+  // Mark the preferred path of `repr` as being modified. The caller holds its latch.
+    auto& version = nodes_[repr]->version;
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    // Order the odd version before the modifications. ThreadSanitizer does not model this fence, see the README.
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void endWrite(unsigned repr) {
+  // Publish the modifications of the preferred path of `repr`. The caller still holds its latch.
+    auto& version = nodes_[repr]->version;
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  void unlockPath(unsigned repr) {
+  // Unlock the preferred path of `repr`.
+    endWrite(repr);
+    nodes_[repr]->latch.unlock();
+  }
+
+  void unlockTrace(Trace& trace) {
   // Unlock the trace.
     for (unsigned index = 0, limit = trace.size(); index != limit; ++index)
-      nodes_[trace[limit - index - 1]]->latch.unlock();
+      unlockPath(trace[limit - index - 1]);
+  }
+
+  // The versions of the preferred paths an optimistic walk entered.
+  struct Snapshots {
+    std::pair<unsigned, unsigned> entries[kMaxOptimisticPaths];
+    unsigned size = 0;
+  };
+
+  CoNode* optimisticWalk(CoNode* x, Snapshots& snapshots) {
+  // Find the root without taking any latch. Returns `nullptr` if the walk has to give up.
+  // We climb the splay trees up to the root of the topmost one, which holds the root path.
+  // The root is then its leftmost node. The walk does not restructure, so the result is only valid
+  // if the versions of all preferred paths it entered, recorded in `snapshots`, did not change.
+    auto enterPath = [&](CoNode* node) -> bool {
+      if (snapshots.size == kMaxOptimisticPaths)
+        return false;
+      auto repr = getRepr(node);
+      auto version = nodes_[repr]->version.load(std::memory_order_acquire);
+
+      // Is a writer active or did the representative change in the meantime?
+      if ((version & 1) || (getRepr(node) != repr))
+        return false;
+      snapshots.entries[snapshots.size++] = {repr, version};
+      return true;
+    };
+
+    if (!enterPath(x))
+      return nullptr;
+    unsigned hops = 0;
+    CoNode* y = x;
+    for (CoNode* p = y->parent; p; y = p, p = y->parent) {
+      if (++hops == kMaxOptimisticHops)
+        return nullptr;
+
+      // Follow a path-parent pointer?
+      if ((p->left != y) && (p->right != y) && !enterPath(p))
+        return nullptr;
+    }
+    // The pending reversals are not pushed, so track the orientation on the way down.
+    bool reversed = y->revert;
+    while (CoNode* next = reversed ? y->right : y->left) {
+      if (++hops == kMaxOptimisticHops)
+        return nullptr;
+      y = next;
+      reversed ^= y->revert;
+    }
+    return y;
+  }
+
+  bool validate(const Snapshots& snapshots) {
+  // Check that no writer modified the paths entered since they were recorded.
+    // Order the loads of the walk before the version checks. As in `beginWrite`, ThreadSanitizer does not model this fence.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    for (unsigned index = 0; index != snapshots.size; ++index) {
+      auto [repr, version] = snapshots.entries[index];
+      if (nodes_[repr]->version.load(std::memory_order_relaxed) != version)
+        return false;
+    }
+    return true;
+  }
+
+  CoNode* tryFindRoot(CoNode* x) {
+  // Find the root without taking any latch. Returns `nullptr` if a concurrent writer interfered.
+    Snapshots snapshots;
+    auto root = optimisticWalk(x, snapshots);
+    return (root && validate(snapshots)) ? root : nullptr;
   }
   
+  void evertExposed(CoNode* x, Trace& trace) {
+  // Make `x` the root of its tree. `x` has been exposed with `trace`, i.e., its splay tree holds the root path.
+  // The representative of a preferred path is its topmost node, so it moves to `x`.
+  // The π-array links each node of the path to its neighbor towards the representative, so this reverses the chain.
+  //
+  // The reversal is lazy, next to latch-free readers:
+  // - Only the root path is reversed. Its latch is in `trace` and its version is odd, see `beginWrite`, and so is the version of `x`
+  //   once `x` becomes the representative. An optimistic walk which overlaps therefore fails its validation, see `validate`.
+  // - The flags still pending below are only pushed by writers under the latch of their path. Optimistic walks never push them.
+  //   They read the flags and track the orientation on the way down instead, see `optimisticWalk`.
+  // - While the chain is reversed, `getRepr` leads either to `repr` or to `x`, and both are latched. A thread which latches
+  //   either one checks `getRepr` again and restarts if it changed, see `exposeInto`.
+    auto repr = getRepr(x);
+    if (repr != x->label) {
+      // `x` is not a representative, so its latch is at most held by threads which are about to restart.
+      if (std::find(trace.begin(), trace.end(), x->label) == trace.end()) {
+        lockLatch(x->label);
+        beginWrite(x->label);
+        trace.push_back(x->label);
+      }
+
+      // Reverse the chain from `x` to `repr`. At any time, a node leads either to `x` or to `repr`.
+      // `repr` stops being a representative, so its shortcuts are invalidated first.
+      markSplit(repr, 0);
+      unsigned prev = x->label, curr = pi_[prev];
+      unlinkInPiArray(prev);
+      while (true) {
+        auto next = pi_[curr];
+        pi_[curr] = prev;
+        if (next == curr)
+          break;
+        prev = curr;
+        curr = next;
+      }
+    }
+
+    // Reverse the root path.
+    x->revert = !x->revert;
+    push(x);
+  }
+
+  void evert(CoNode* x) {
+    auto trace = pathExpose(x);
+
+    // Reroot.
+    evertExposed(x, trace);
+
+    // And unlock the trace.
+    unlockTrace(trace);
+  }
+
   void link(CoNode* x, CoNode* y) {
     auto trace = pathExpose(x);
     
-    // `x` must be a root node.
+    // Make `x` the root of its tree, so that it can be linked.
+    evertExposed(x, trace);
     assert(!x->left);
     x->parent = y;
 
@@ -214,6 +704,11 @@ public:
     assert(!!x->left);
     x->left->parent = nullptr;
     x->left = nullptr;
+    pull(x);
+    if constexpr (kShortcuts) {
+      auto repr = getRepr(x);
+      markSplit(repr, depthInPath(x, repr));
+    }
     unlinkInPiArray(x->label);
     
     // And unlock the trace.
@@ -221,10 +716,18 @@ public:
   }
 
   CoNode* findRoot(CoNode* x) {
+    // Try the latch-free lookup first.
+    if (auto root = tryFindRoot(x)) {
+      Stats::add(kOptimisticHits);
+      return root;
+    }
+    Stats::add(kOptimisticMisses);
+
+    // A writer interfered, so expose `x`.
     auto trace = pathExpose(x);
     
     // Find the root.
-    while (x->left) x = x->left;
+    x = leftmost(x);
     
     // Amortized cost.
     splay(x);
@@ -233,4 +736,150 @@ public:
     unlockTrace(trace);
     return x;
   }
+
+  bool connected(CoNode* x, CoNode* y) {
+    // Try the latch-free lookups first. Both walks are validated at once, so they observed the same state.
+    Snapshots snapshots;
+    auto rootOfX = optimisticWalk(x, snapshots);
+    auto rootOfY = rootOfX ? optimisticWalk(y, snapshots) : nullptr;
+    if (rootOfY && validate(snapshots)) {
+      Stats::add(kOptimisticHits);
+      return rootOfX == rootOfY;
+    }
+    Stats::add(kOptimisticMisses);
+
+    // A writer interfered, so expose both.
+    return exposePair(x, y, [&](CoNode* rootOfX, CoNode*) {
+      return rootOfX == leftmost(y);
+    });
+  }
+
+  CoNode* lca(CoNode* x, CoNode* y) {
+    // Expose `x`, then `y`: the exposure of `y` joins the root path last at their lowest common ancestor.
+    // Returns `nullptr` if `x` and `y` are not connected.
+    return exposePair(x, y, [&](CoNode* rootOfX, CoNode* lastOfY) -> CoNode* {
+      return (rootOfX == leftmost(y)) ? lastOfY : nullptr;
+    });
+  }
+
+  void setWeight(CoNode* x, typename Monoid::Type weight) {
+    auto trace = pathExpose(x);
+
+    // `x` is the root of its splay tree, so only its own aggregate changes.
+    x->weight = weight;
+    pull(x);
+
+    // And unlock the trace.
+    unlockTrace(trace);
+  }
+
+  typename Monoid::Type pathAggregate(CoNode* x) {
+    auto trace = pathExpose(x);
+
+    // The splay tree of `x` holds exactly the path from the root to `x`.
+    auto aggregate = x->aggregate;
+
+    // And unlock the trace.
+    unlockTrace(trace);
+    return aggregate;
+  }
+
+  void linkBatch(WorkerPool& pool, const Operation* ops, size_t count, unsigned taskFactor = 1) {
+    // Link `ops[index].first` to `ops[index].second`. The links must be valid in any order.
+    runGrouped(pool, ops, count, taskFactor, [&](size_t index) {
+      link(nodes_[ops[index].first], nodes_[ops[index].second]);
+    });
+  }
+
+  void cutBatch(WorkerPool& pool, const Operation* ops, size_t count, unsigned taskFactor = 1) {
+    // Cut `ops[index].first` from its parent.
+    runGrouped(pool, ops, count, taskFactor, [&](size_t index) {
+      cut(nodes_[ops[index].first]);
+    });
+  }
+
+  void findRootBatch(WorkerPool& pool, const Operation* ops, size_t count, CoNode** roots, unsigned taskFactor = 1) {
+    // Store the root of `ops[index].first` in `roots[index]`.
+    runGrouped(pool, ops, count, taskFactor, [&](size_t index) {
+      roots[index] = findRoot(nodes_[ops[index].first]);
+    });
+  }
+
+private:
+  // The buffers of `runGrouped`, kept across batches, so that a batch does not allocate once they are large enough.
+  struct GroupBuffers {
+    // The bucket of each operation.
+    std::vector<unsigned> keys;
+    // The start of each bucket in `order`, and the insert positions while sorting.
+    std::vector<size_t> offsets;
+    std::vector<size_t> cursors;
+    // The operations, sorted by bucket.
+    std::vector<unsigned> order;
+    // The bounds of the tasks in `order`.
+    std::vector<size_t> bounds;
+  };
+  GroupBuffers groupBuffers_;
+
+  template <class Fn>
+  void runGrouped(WorkerPool& pool, const Operation* ops, size_t count, unsigned taskFactor, Fn&& fn) {
+  // Run `fn(index)` for all operations of the batch on the workers of `pool`.
+  // The operations are grouped by the current representative of the preferred path of `ops[index].first`:
+  // groups are hashed into buckets, and the buckets are cut into tasks, which the workers consume in parallel.
+  // Thus, operations which would compete for the same latch mostly run one after the other on the same worker.
+  // A bucket larger than a task is split, so that a single large tree does not serialize the batch.
+  // The buffers are shared by the batches of the tree, so they must not run at the same time.
+    unsigned numWorkers = pool.size();
+    size_t taskSize = numWorkers ? count / (size_t(taskFactor) * numWorkers) : 0;
+    if (!taskSize) {
+      for (size_t index = 0; index != count; ++index)
+        fn(index);
+      return;
+    }
+
+    // Compute the keys. The batch did not start yet, so the π-array is stable.
+    auto& keys = groupBuffers_.keys;
+    auto& offsets = groupBuffers_.offsets;
+    auto& cursors = groupBuffers_.cursors;
+    auto& order = groupBuffers_.order;
+    auto& bounds = groupBuffers_.bounds;
+    keys.resize(count);
+    size_t numBuckets = size_t(taskFactor) * numWorkers * kBucketsPerTask;
+    pool.run([&](unsigned workerId) {
+      for (size_t index = workerId; index < count; index += numWorkers)
+        keys[index] = getRepr(nodes_[ops[index].first]) % numBuckets;
+    });
+
+    // Sort the operations by bucket (counting sort).
+    offsets.assign(numBuckets + 1, 0);
+    for (auto key : keys)
+      ++offsets[key + 1];
+    for (size_t bucket = 0; bucket != numBuckets; ++bucket)
+      offsets[bucket + 1] += offsets[bucket];
+    order.resize(count);
+    cursors.assign(offsets.begin(), offsets.end());
+    for (size_t index = 0; index != count; ++index)
+      order[cursors[keys[index]]++] = index;
+
+    // Cut the buckets into tasks. A task ends at a bucket boundary, once it is large enough.
+    bounds.assign(1, 0);
+    for (size_t bucket = 1; bucket <= numBuckets; ++bucket) {
+      while (offsets[bucket] - bounds.back() >= 2 * taskSize)
+        bounds.push_back(bounds.back() + taskSize);
+      if (offsets[bucket] - bounds.back() >= taskSize)
+        bounds.push_back(offsets[bucket]);
+    }
+    if (bounds.back() != count)
+      bounds.push_back(count);
+
+    // Consume the tasks.
+    std::atomic<size_t> taskIndex = 0;
+    size_t numTasks = bounds.size() - 1;
+    pool.run([&](unsigned) {
+      for (size_t task; (task = taskIndex.fetch_add(1, std::memory_order_relaxed)) < numTasks; ) {
+        for (size_t pos = bounds[task]; pos != bounds[task + 1]; ++pos)
+          fn(order[pos]);
+      }
+    });
+  }
 };
+#endif
@@ -0,0 +1,72 @@
+#ifndef INLINE_VECTOR_HPP
+#define INLINE_VECTOR_HPP
+#include <assert.h>
+#include <vector>
+
+// A vector which stores up to `kInlineCapacity` elements inline and only spills to the heap beyond.
+// It is used for the traces of `ConcurrentLinkCutTrees::pathExpose`: an exposure usually crosses few preferred paths,
+// so the common case does not allocate. `T` must be trivially copyable.
+template <class T, unsigned kInlineCapacity>
+class InlineVector {
+public:
+  // The number of elements.
+  unsigned size() const { return spilled_ ? spill_.size() : size_; }
+  // Whether there are no elements.
+  bool empty() const { return !size(); }
+  // Whether the elements moved to the heap.
+  bool spilled() const { return spilled_; }
+
+  T* begin() { return spilled_ ? spill_.data() : inline_; }
+  T* end() { return begin() + size(); }
+  const T* begin() const { return spilled_ ? spill_.data() : inline_; }
+  const T* end() const { return begin() + size(); }
+
+  T& operator[](unsigned index) { return begin()[index]; }
+  const T& operator[](unsigned index) const { return begin()[index]; }
+  T& back() { assert(!empty()); return end()[-1]; }
+
+  void push_back(T value) {
+    if (!spilled_) {
+      if (size_ != kInlineCapacity) {
+        inline_[size_++] = value;
+        return;
+      }
+      spill();
+    }
+    spill_.push_back(value);
+  }
+
+  void pop_back() {
+    assert(!empty());
+    if (spilled_)
+      spill_.pop_back();
+    else
+      --size_;
+  }
+
+  void clear() {
+    // Go back to the inline storage. The heap storage is kept for the next spill.
+    size_ = 0;
+    spill_.clear();
+    spilled_ = false;
+  }
+
+private:
+  // The number of inline elements.
+  unsigned size_ = 0;
+  // Whether the elements are stored in `spill_`.
+  bool spilled_ = false;
+  // The inline elements.
+  T inline_[kInlineCapacity];
+  // The elements, once spilled.
+  std::vector<T> spill_;
+
+  void spill() {
+    // Only called once the inline storage is full.
+    assert(size_ == kInlineCapacity);
+    spill_.reserve(2 * kInlineCapacity);
+    spill_.assign(inline_, inline_ + kInlineCapacity);
+    spilled_ = true;
+  }
+};
+#endif
@@ -1,17 +1,28 @@
+#ifndef LCT_HPP
+#define LCT_HPP
 #include <assert.h>
 #include <iostream>
+#include <utility>
+#include <vector>
+#include "Monoids.hpp"
+#include "Stats.hpp"
 
 #define DEBUG 0
 
 // Inspired from: https://github.com/indy256/codelibrary/blob/master/java/structures/LinkCutTree.java
+// Path aggregates are maintained for `Monoid`, see `Monoids.hpp`, and the hot paths are counted by `Stats`, see `Stats.hpp`.
+template <class Monoid = NoAggregate, class Stats = NoStats>
 class LinkCutTree {
+  static_assert(isCommutative<Monoid>, "`evert` does not mirror the aggregates, so the monoid has to be commutative, see `Monoids.hpp`.");
+
 public:
-  class Node {
+  class Node : public AggregateSlot<Monoid> {
     friend class LinkCutTree;
     Node* left = nullptr;
     Node* right = nullptr;
     Node* parent = nullptr;
-    bool revert;
+    // Whether the children of all nodes in the splay subtree are to be swapped (lazy reversal).
+    bool revert = false;
     
     bool isRoot() {
       // The first check refers to general root.
@@ -25,6 +36,11 @@ public:
   };
   
      
+private:
+  // The stack of `pushDown`.
+  std::vector<Node*> pushStack_;
+
+public:
   void printBT(const std::string& prefix, const Node* node, bool isLeft) {
     if (node != nullptr)
         {
@@ -46,6 +62,47 @@ public:
         printBT("", node, false);    
     }
   
+  // Recomputes the aggregate of `x` from its children.
+  void pull(Node* x) {
+    if constexpr (hasAggregate<Monoid>) {
+      auto aggregate = x->weight;
+      if (x->left)
+        aggregate = Monoid::combine(x->left->aggregate, aggregate);
+      if (x->right)
+        aggregate = Monoid::combine(aggregate, x->right->aggregate);
+      x->aggregate = aggregate;
+    }
+  }
+
+  // Applies a pending reversal of `x` to its children.
+  void push(Node* x) {
+    if (x->revert) {
+      std::swap(x->left, x->right);
+      if (x->left)
+        x->left->revert ^= true;
+      if (x->right)
+        x->right->revert ^= true;
+      x->revert = false;
+    }
+  }
+
+  // Pushes the pending reversals on the way from the root of the splay tree down to `x`.
+  void pushDown(Node* x) {
+    // Most splay trees are not reversed, so check first.
+    bool pending = x->revert;
+    for (Node* y = x; !pending && !y->isRoot(); y = y->parent)
+      pending = y->parent->revert;
+    if (!pending)
+      return;
+
+    pushStack_.clear();
+    for (Node* y = x; !y->isRoot(); y = y->parent)
+      pushStack_.push_back(y->parent);
+    for (unsigned index = pushStack_.size(); index != 0; --index)
+      push(pushStack_[index - 1]);
+    push(x);
+  }
+
   // rotates edge (x, x.parent)
   //        g            g
   //       /            /
@@ -83,6 +140,11 @@ public:
       else
         g->right = x;
     }
+
+    // `p` is now below `x`.
+    pull(p);
+    pull(x);
+    Stats::add(kRotations);
   }
   
   // brings x to the root, balancing tree
@@ -108,6 +170,8 @@ public:
 #if DEBUG
     std::cerr << "\t[splay start] node=" << x->value << std::endl;
 #endif
+    pushDown(x);
+    uint64_t rotations = 0;
     while (!x->isRoot()) { 
       Node* p = x->parent;
       Node* g = p->parent;
@@ -118,8 +182,10 @@ public:
 #endif
       if (!p->isRoot()) {
         rotate(((x == p->left) == (p == g->left)) ? p /* zig-zig case */ : x /* zig-zag case */);
+        ++rotations;
       }
       rotate(x);
+      ++rotations;
 #if DEBUG
       std::cerr << "\t\t[splay-inside] after rotation:" << std::endl;
       printBT(x);
@@ -128,6 +194,8 @@ public:
 #if DEBUG
     std::cerr << "\t[splay finish]" << std::endl;
 #endif
+    Stats::add(kSplays);
+    Stats::max(kMaxSplayRotations, rotations);
   }
   
   Node* expose(Node* x) {
@@ -140,7 +208,13 @@ public:
       std::cerr << "[expose] splay y=" << y->value << " parent=" << (y->parent ? std::to_string(y->parent->value) : "nullptr") << std::endl;
 #endif
       splay(y);
+      if constexpr (Stats::kEnabled) {
+        Stats::add(kPathsJoined);
+        if (y->left)
+          Stats::add(kPathSwitches);
+      }
       y->left = last;
+      pull(y);
       //rotate(x);
       last = y;
     }
@@ -150,26 +224,35 @@ public:
     std::cerr << "[expose] last splay x=" << x->value << std::endl;
 #endif
     splay(x);
+    Stats::add(kExposes);
     return last;
   }
   
   void link(Node* x, Node* y) {
-    auto rx = findRoot(x), ry = findRoot(y);
-    assert(rx != ry);
+    // `x` and `y` must be in different trees. As in `ArenaLinkCutTree`, this is only checked in debug builds.
+    assert(findRoot(x) != findRoot(y));
 #if DEBUG
     std::cerr << "%% [link] x=" << x->value << " y=" << y->value << std::endl;
 #endif
-    expose(x);
+    
+    // Make `x` the root of its tree, so that it can be linked. `evert` exposes `x` first.
+    evert(x);
     
 #if DEBUG
     printBT(x);
     printBT(y);
 #endif
-    
-    // x must be a root node.
+    push(x);
     assert(!x->right);
     x->parent = y;
   }
+
+  void evert(Node* x) {
+    // Make `x` the root of its tree by reversing the path from the root to `x`.
+    // Note that the aggregates are not mirrored, hence `Monoid` is commutative.
+    expose(x);
+    x->revert ^= true;
+  }
   
   void cut(Node* x) {
     // Delete `v` from its parent.
@@ -177,6 +260,7 @@ public:
     assert(!!x->right);
     x->right->parent = nullptr;
     x->right = nullptr;
+    pull(x);
   }
   
   Node* findRoot(Node* x) {
@@ -185,7 +269,10 @@ public:
 #endif
     // Find the root `r` of `v`.
     expose(x);
-    while (x->right) x = x->right;
+    while (x->right) {
+      x = x->right;
+      push(x);
+    }
     
     // Amortized cost.
 #if DEBUG
@@ -204,4 +291,18 @@ public:
   bool areConnected(Node* x, Node* y) {
     return findRoot(x) == findRoot(y);
   }
+
+  void setWeight(Node* x, typename Monoid::Type weight) {
+    // After `expose`, `x` is the root of its splay tree, so only its own aggregate changes.
+    expose(x);
+    x->weight = weight;
+    pull(x);
+  }
+
+  typename Monoid::Type pathAggregate(Node* x) {
+    // The aggregate of the weights on the path from the root to `x`.
+    expose(x);
+    return x->aggregate;
+  }
 };
+#endif
@@ -0,0 +1,145 @@
+#ifndef LATCHES_HPP
+#define LATCHES_HPP
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Latch policies for `ConcurrentLinkCutTrees`.
+// All of them follow the `std::mutex` interface (`lock`, `try_lock`, `unlock`), so `std::mutex` is a policy as well.
+
+// Yield the pipeline to the sibling hyper-thread while spinning.
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#else
+  std::this_thread::yield();
+#endif
+}
+
+// Test-and-test-and-set spinlock with exponential backoff. It occupies a single byte.
+class TTASLatch {
+  // Whether the latch is taken.
+  std::atomic<bool> taken_ = false;
+
+  // The bounds of the backoff, in pause instructions.
+  static constexpr unsigned kMinBackoff = 4;
+  static constexpr unsigned kMaxBackoff = 1u << 10;
+
+public:
+  void lock() {
+    unsigned backoff = kMinBackoff;
+    while (taken_.exchange(true, std::memory_order_acquire)) {
+      // Spin on the cached value and back off after each failed attempt.
+      do {
+        for (unsigned index = 0; index != backoff; ++index)
+          cpuRelax();
+        if (backoff < kMaxBackoff)
+          backoff <<= 1;
+      } while (taken_.load(std::memory_order_relaxed));
+    }
+  }
+
+  bool try_lock() {
+    return !taken_.load(std::memory_order_relaxed) && !taken_.exchange(true, std::memory_order_acquire);
+  }
+
+  void unlock() { taken_.store(false, std::memory_order_release); }
+};
+static_assert(sizeof(TTASLatch) == 1);
+
+// MCS queue lock: the waiting threads form a queue and each one spins on its own queue node.
+// Thus, a release only invalidates the cache line of the successor.
+// A thread can hold several latches at once (see `pathExpose`), so the queue nodes come from a thread-local free list.
+// The queue node of the holder is stored in the latch itself, so the interface matches `std::mutex`.
+class MCSLatch {
+  struct alignas(64) QNode {
+    // The successor in the queue.
+    std::atomic<QNode*> next;
+    // Whether the thread still has to wait.
+    std::atomic<bool> waiting;
+  };
+
+  // The free list of queue nodes of this thread.
+  class QNodePool {
+    std::vector<QNode*> free_;
+
+  public:
+    ~QNodePool() {
+      for (auto qnode : free_)
+        delete qnode;
+    }
+
+    QNode* acquire() {
+      if (free_.empty())
+        return new QNode();
+      auto qnode = free_.back();
+      free_.pop_back();
+      return qnode;
+    }
+
+    void release(QNode* qnode) { free_.push_back(qnode); }
+  };
+
+  static QNodePool& qnodePool() {
+    static thread_local QNodePool pool;
+    return pool;
+  }
+
+  // The last thread in the queue.
+  std::atomic<QNode*> tail_ = nullptr;
+  // The queue node of the holder. It is only accessed by the holder.
+  QNode* owner_ = nullptr;
+
+public:
+  void lock() {
+    auto qnode = qnodePool().acquire();
+    qnode->next.store(nullptr, std::memory_order_relaxed);
+    qnode->waiting.store(true, std::memory_order_relaxed);
+
+    // Enqueue.
+    auto predecessor = tail_.exchange(qnode, std::memory_order_acq_rel);
+    if (predecessor) {
+      predecessor->next.store(qnode, std::memory_order_release);
+      while (qnode->waiting.load(std::memory_order_acquire))
+        cpuRelax();
+    }
+    owner_ = qnode;
+  }
+
+  bool try_lock() {
+    auto qnode = qnodePool().acquire();
+    qnode->next.store(nullptr, std::memory_order_relaxed);
+    QNode* expected = nullptr;
+    if (!tail_.compare_exchange_strong(expected, qnode, std::memory_order_acq_rel)) {
+      qnodePool().release(qnode);
+      return false;
+    }
+    owner_ = qnode;
+    return true;
+  }
+
+  void unlock() {
+    auto qnode = owner_;
+    auto successor = qnode->next.load(std::memory_order_acquire);
+    if (!successor) {
+      // Are we the last one?
+      auto expected = qnode;
+      if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+        qnodePool().release(qnode);
+        return;
+      }
+
+      // A thread is enqueuing: wait until it linked itself.
+      while (!(successor = qnode->next.load(std::memory_order_acquire)))
+        cpuRelax();
+    }
+
+    // Hand over the latch.
+    successor->waiting.store(false, std::memory_order_release);
+    qnodePool().release(qnode);
+  }
+};
+#endif
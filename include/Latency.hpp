@@ -0,0 +1,151 @@
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+#include "WorkloadFile.hpp"
+
+// A histogram of latencies in nanoseconds with log-linear buckets, as in HDR histograms.
+// The values below 2^kSubBits have their own buckets. Above, each power of two is split into 2^kSubBits buckets,
+// so that a bucket is at most 1/2^kSubBits, i.e., about 3%, wider than its lowest value.
+class LatencyHistogram {
+public:
+  static constexpr unsigned kSubBits = 5;
+  static constexpr unsigned kSubBuckets = 1u << kSubBits;
+  static constexpr unsigned kNumBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+  void add(uint64_t ns) {
+    ++counts_[bucketOf(ns)];
+    ++count_;
+    max_ = std::max(max_, ns);
+  }
+
+  void merge(const LatencyHistogram& other) {
+    for (unsigned index = 0; index != kNumBuckets; ++index)
+      counts_[index] += other.counts_[index];
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  // The number of values.
+  uint64_t count() const { return count_; }
+  // The largest value.
+  uint64_t max() const { return max_; }
+
+  uint64_t percentile(double q) const {
+  // The value of the `q`-quantile, i.e., the highest value of its bucket, but at most the largest value.
+    if (!count_)
+      return 0;
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * count_ + 0.5)), seen = 0;
+    for (unsigned index = 0; index != kNumBuckets; ++index) {
+      seen += counts_[index];
+      if (seen >= rank)
+        return std::min(max_, (index + 1 == kNumBuckets) ? max_ : lowestOf(index + 1) - 1);
+    }
+    return max_;
+  }
+
+private:
+  static unsigned bucketOf(uint64_t ns) {
+    if (ns < kSubBuckets)
+      return ns;
+    unsigned shift = 63 - __builtin_clzll(ns) - kSubBits;
+    return (shift + 1) * kSubBuckets + ((ns >> shift) - kSubBuckets);
+  }
+
+  static uint64_t lowestOf(unsigned bucket) {
+    if (bucket < kSubBuckets)
+      return bucket;
+    unsigned shift = bucket / kSubBuckets - 1;
+    return static_cast<uint64_t>(kSubBuckets + bucket % kSubBuckets) << shift;
+  }
+
+  uint64_t counts_[kNumBuckets] = {};
+  uint64_t count_ = 0;
+  uint64_t max_ = 0;
+};
+
+// Sampled latencies of the operations, per phase, i.e., the kind of the batch, and per operation.
+// Each slot, e.g., a worker of a `WorkerPool`, records into its own histograms, which `merged` combines once the run ended.
+// Only every `sampling`-th operation of a slot is timed, so that the clock stays off the hot path. A `sampling` of 0 disables the recorder.
+class LatencyRecorder {
+public:
+  static constexpr unsigned kNumPhases = kMixed + 1;
+  static constexpr unsigned kNumOps = kCut + 1;
+
+  LatencyRecorder(unsigned numSlots, unsigned sampling)
+  // The constructor.
+  : slots_(sampling ? numSlots : 0), sampling_(sampling) {}
+
+  // Whether operations are timed.
+  bool enabled() const { return sampling_; }
+
+  template <class Fn>
+  void record(unsigned slot, unsigned phase, unsigned op, Fn&& fn) {
+  // Run `fn`, i.e., operation `op` of a batch of kind `phase`, and time it if it is sampled.
+    if (!sampling_) {
+      fn();
+      return;
+    }
+    auto& state = slots_[slot];
+    if (--state.countdown) {
+      fn();
+      return;
+    }
+    state.countdown = sampling_;
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    state.histograms[phase][op].add(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+  }
+
+  void reset() {
+  // Drop all samples. The next operation of each slot is sampled.
+    for (auto& state : slots_)
+      state = Slot();
+  }
+
+  LatencyHistogram merged(unsigned phase, unsigned op) const {
+  // The histogram of `op` in `phase` over all slots.
+    LatencyHistogram histogram;
+    for (auto& state : slots_)
+      histogram.merge(state.histograms[phase][op]);
+    return histogram;
+  }
+
+  void report(std::ostream& out) const {
+  // Print the percentiles of all operations which were sampled, in microseconds.
+    static const char* phaseNames[kNumPhases] = {"lookup", "link", "cut", "mixed"};
+    static const char* opNames[kNumOps] = {"findRoot", "link", "cut"};
+    if (!sampling_)
+      return;
+    out << "Latency (1/" << sampling_ << " sampled, µs):" << std::endl;
+    for (unsigned phase = 0; phase != kNumPhases; ++phase) {
+      for (unsigned op = 0; op != kNumOps; ++op) {
+        auto histogram = merged(phase, op);
+        if (!histogram.count())
+          continue;
+        auto us = [](uint64_t ns) { return ns / 1000.0; };
+        out << std::fixed << std::setprecision(2)
+            << "  " << phaseNames[phase] << "/" << opNames[op] << ": " << histogram.count() << " samples"
+            << ", p50=" << us(histogram.percentile(0.5)) << ", p99=" << us(histogram.percentile(0.99))
+            << ", p99.9=" << us(histogram.percentile(0.999)) << ", max=" << us(histogram.max()) << std::endl;
+        out.unsetf(std::ios::floatfield);
+      }
+    }
+  }
+
+private:
+  struct alignas(64) Slot {
+    LatencyHistogram histograms[kNumPhases][kNumOps];
+    // The operations until the next sample.
+    uint64_t countdown = 1;
+  };
+
+  std::vector<Slot> slots_;
+  unsigned sampling_;
+};
+#endif
@@ -0,0 +1,74 @@
+#ifndef MONOIDS_HPP
+#define MONOIDS_HPP
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+// Monoids for path aggregates in `LinkCutTree` and `ConcurrentLinkCutTrees`.
+// A monoid defines its value `Type`, its `identity()` and an associative `combine(lhs, rhs)`.
+// The aggregate of a splay tree is the in-order combination of its weights.
+// `evert` reverses a path lazily, without mirroring the aggregates, so `combine` must also be commutative.
+// A monoid declares this with `kCommutative`, which the trees check, see `isCommutative`.
+//
+// The weights belong to the nodes. An edge weight cannot be stored on the child, since `evert` changes which endpoint
+// is the child. To aggregate edge weights, e.g., the bottleneck capacity of a path, represent each edge `(u, v)` by a node `e`
+// of its own, which carries the weight and is linked between `u` and `v`, and give the vertices the identity as weight.
+
+// No aggregate. The nodes do not store any weight.
+struct NoAggregate {
+  static constexpr bool kCommutative = true;
+  struct Type {};
+  static constexpr Type identity() { return {}; }
+  static constexpr Type combine(Type, Type) { return {}; }
+};
+
+// Path sum.
+template <class T>
+struct SumMonoid {
+  static constexpr bool kCommutative = true;
+  using Type = T;
+  static constexpr T identity() { return T(0); }
+  static constexpr T combine(T lhs, T rhs) { return lhs + rhs; }
+};
+
+// Path minimum, e.g., the bottleneck capacity, with the edges as nodes.
+template <class T>
+struct MinMonoid {
+  static constexpr bool kCommutative = true;
+  using Type = T;
+  static constexpr T identity() { return std::numeric_limits<T>::max(); }
+  static constexpr T combine(T lhs, T rhs) { return std::min(lhs, rhs); }
+};
+
+// Path maximum.
+template <class T>
+struct MaxMonoid {
+  static constexpr bool kCommutative = true;
+  using Type = T;
+  static constexpr T identity() { return std::numeric_limits<T>::lowest(); }
+  static constexpr T combine(T lhs, T rhs) { return std::max(lhs, rhs); }
+};
+
+// Whether `Monoid` declares a commutative `combine`. Monoids without `kCommutative` are treated as not commutative.
+template <class Monoid, class = void>
+static constexpr bool isCommutative = false;
+
+template <class Monoid>
+static constexpr bool isCommutative<Monoid, std::void_t<decltype(Monoid::kCommutative)>> = Monoid::kCommutative;
+
+// Whether `Monoid` maintains an aggregate.
+template <class Monoid>
+static constexpr bool hasAggregate = !std::is_same_v<Monoid, NoAggregate>;
+
+// The per-node storage of `Monoid`. Nodes inherit from it, so that `NoAggregate` costs nothing.
+template <class Monoid>
+struct AggregateSlot {
+  // The weight of the node.
+  typename Monoid::Type weight = Monoid::identity();
+  // The aggregate of its splay subtree.
+  typename Monoid::Type aggregate = Monoid::identity();
+};
+
+template <>
+struct AggregateSlot<NoAggregate> {};
+#endif
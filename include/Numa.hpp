@@ -0,0 +1,211 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// NUMA support for the benchmarks: the topology, the pinning of workers and the placement of memory.
+// It only relies on sysfs and on the raw system calls, so that it does not depend on libnuma.
+
+// How the workers are pinned to cores.
+enum class PinPolicy {
+  // Not pinned, i.e., left to the scheduler.
+  kNone,
+  // Fill the cores of one NUMA node before the next one.
+  kCompact,
+  // Distribute the workers round-robin over the NUMA nodes.
+  kScatter
+};
+
+// Where the nodes of the trees are placed.
+enum class Placement {
+  // Allocated by the main thread, i.e., first-touched on its NUMA node.
+  kDefault,
+  // Allocated by the pinned workers, each on a partition of the labels, i.e., first-touched on their NUMA nodes.
+  kFirstTouch,
+  // Allocated by the main thread, with the pages interleaved over all NUMA nodes.
+  kInterleave
+};
+
+class NumaTopology {
+public:
+  NumaTopology()
+  // The constructor. Read the topology from sysfs and restrict it to the CPUs the process may run on.
+  {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool restricted = !sched_getaffinity(0, sizeof(allowed), &allowed);
+    auto isAllowed = [&](unsigned cpu) { return !restricted || ((cpu < CPU_SETSIZE) && CPU_ISSET(cpu, &allowed)); };
+
+    for (unsigned node : parseList(readFile("/sys/devices/system/node/online"))) {
+      std::vector<unsigned> cpus;
+      for (unsigned cpu : parseList(readFile("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")))
+        if (isAllowed(cpu))
+          cpus.push_back(cpu);
+      if (!cpus.empty()) {
+        nodeIds_.push_back(node);
+        cpus_.push_back(std::move(cpus));
+      }
+    }
+    memoryNodes_ = parseList(readFile("/sys/devices/system/node/has_memory"));
+
+    // Without sysfs, assume a single NUMA node with all allowed CPUs.
+    if (cpus_.empty()) {
+      std::vector<unsigned> cpus;
+      for (unsigned cpu = 0, limit = std::max(std::thread::hardware_concurrency(), 1u); cpu != limit; ++cpu)
+        if (isAllowed(cpu))
+          cpus.push_back(cpu);
+      nodeIds_ = {0};
+      cpus_ = {std::move(cpus)};
+    }
+  }
+
+  // The number of NUMA nodes with usable CPUs.
+  unsigned numNodes() const { return cpus_.size(); }
+
+  // The NUMA node of `cpu`.
+  unsigned nodeOf(unsigned cpu) const {
+    for (unsigned index = 0; index != numNodes(); ++index)
+      if (std::find(cpus_[index].begin(), cpus_[index].end(), cpu) != cpus_[index].end())
+        return nodeIds_[index];
+    return nodeIds_.front();
+  }
+
+  std::vector<int> assignCpus(unsigned numWorkers, PinPolicy policy) const {
+  // The CPU of each worker, or -1 if not pinned. If there are more workers than CPUs, the CPUs are reused cyclically.
+    std::vector<int> assignment(numWorkers, -1);
+    if (policy == PinPolicy::kNone)
+      return assignment;
+    if (policy == PinPolicy::kCompact) {
+      std::vector<unsigned> order;
+      for (auto& cpus : cpus_)
+        order.insert(order.end(), cpus.begin(), cpus.end());
+      for (unsigned worker = 0; worker != numWorkers; ++worker)
+        assignment[worker] = order[worker % order.size()];
+    } else {
+      for (unsigned worker = 0; worker != numWorkers; ++worker) {
+        auto& cpus = cpus_[worker % numNodes()];
+        assignment[worker] = cpus[(worker / numNodes()) % cpus.size()];
+      }
+    }
+    return assignment;
+  }
+
+  std::string describe() const {
+  // A one-line description, e.g., "2 NUMA node(s): node0=[0-27] node1=[28-55]".
+    std::ostringstream out;
+    out << numNodes() << " NUMA node(s):";
+    for (unsigned index = 0; index != numNodes(); ++index)
+      out << " node" << nodeIds_[index] << "=[" << formatList(cpus_[index]) << "]";
+    return out.str();
+  }
+
+  bool setInterleave(bool enable) const {
+  // Interleave the pages first-touched by the calling thread over all NUMA nodes with memory, or restore the default policy.
+  // Returns false if the kernel refused, e.g., in a container without the capability.
+#ifdef SYS_set_mempolicy
+    static constexpr int kMpolDefault = 0, kMpolInterleave = 3;
+    if (!enable)
+      return !syscall(SYS_set_mempolicy, kMpolDefault, nullptr, 0);
+    static constexpr unsigned kBitsPerWord = 8 * sizeof(unsigned long);
+    unsigned maxNode = memoryNodes_.empty() ? 0 : *std::max_element(memoryNodes_.begin(), memoryNodes_.end());
+    std::vector<unsigned long> mask(maxNode / kBitsPerWord + 1, 0);
+    for (unsigned node : memoryNodes_)
+      mask[node / kBitsPerWord] |= 1ul << (node % kBitsPerWord);
+    if (memoryNodes_.empty())
+      mask[0] = 1;
+    return !syscall(SYS_set_mempolicy, kMpolInterleave, mask.data(), maxNode + 2);
+#else
+    return !enable;
+#endif
+  }
+
+  static bool pinCurrentThread(int cpu) {
+  // Pin the calling thread to `cpu`. A negative `cpu` leaves it unpinned.
+    if (cpu < 0)
+      return true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return !pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  static std::string formatList(const std::vector<unsigned>& values) {
+  // Format sorted `values` in the sysfs list format, e.g., "0-3,8".
+    std::string result;
+    for (unsigned index = 0; index != values.size();) {
+      unsigned last = index;
+      while ((last + 1 != values.size()) && (values[last + 1] == values[last] + 1))
+        ++last;
+      if (!result.empty())
+        result += ",";
+      result += std::to_string(values[index]);
+      if (last != index)
+        result += "-" + std::to_string(values[last]);
+      index = last + 1;
+    }
+    return result;
+  }
+
+private:
+  // The ids of the NUMA nodes with usable CPUs.
+  std::vector<unsigned> nodeIds_;
+  // The usable CPUs of each of them.
+  std::vector<std::vector<unsigned>> cpus_;
+  // The ids of the NUMA nodes with memory.
+  std::vector<unsigned> memoryNodes_;
+
+  static std::string readFile(const std::string& path) {
+    std::ifstream input(path);
+    std::string line;
+    std::getline(input, line);
+    return line;
+  }
+
+  static std::vector<unsigned> parseList(const std::string& list) {
+  // Parse the sysfs list format, e.g., "0-3,8-11".
+    std::vector<unsigned> values;
+    std::istringstream input(list);
+    for (std::string range; std::getline(input, range, ',');) {
+      if (range.empty())
+        continue;
+      auto dash = range.find('-');
+      unsigned first = std::stoul(range.substr(0, dash));
+      unsigned last = (dash == std::string::npos) ? first : std::stoul(range.substr(dash + 1));
+      for (unsigned value = first; value <= last; ++value)
+        values.push_back(value);
+    }
+    return values;
+  }
+};
+
+// Interleave the pages first-touched by the calling thread while in scope, if `enable` is set.
+class InterleaveScope {
+public:
+  InterleaveScope(const NumaTopology& topology, bool enable)
+  // The constructor.
+  : topology_(topology), active_(enable && topology.setInterleave(true)) {}
+
+  ~InterleaveScope()
+  // The destructor. Restore the default policy.
+  {
+    if (active_)
+      topology_.setInterleave(false);
+  }
+
+  InterleaveScope(const InterleaveScope&) = delete;
+  InterleaveScope& operator=(const InterleaveScope&) = delete;
+
+private:
+  const NumaTopology& topology_;
+  // Whether the interleaving took effect.
+  bool active_;
+};
+#endif
@@ -0,0 +1,183 @@
+#ifndef PACKED_CODEC_HPP
+#define PACKED_CODEC_HPP
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// The blocks of the packed workload encoding. A block holds one batch:
+// - a `BlockHeader`, i.e., the kind, the number of operations and the size of the block,
+// - the column of the `u`s and the column of the `v`s, each a `ColumnHeader` followed by `count` values of `width` bits.
+// Each column picks the mode with the smallest width:
+// - `kFrame`: the values minus `base`, the smallest value.
+// - `kDelta`: the zigzag-encoded differences to the previous value, starting at `base`.
+// - `kParent`: for the `v`s only, the zigzag-encoded differences to the parent of `u` in a k-ary tree, i.e., `(u - 1) / k`.
+// Shuffled operations on random trees thus shrink to about twice the bits of n, and k-ary links and cuts to about those of n.
+// All blocks and columns are padded to 8 bytes and end with 8 spare bytes, so that the decoder can use unaligned 64-bit loads.
+class PackedCodec {
+public:
+  using Entry = std::pair<unsigned, unsigned>;
+
+  enum ColumnMode : uint8_t {
+    kFrame = 0,
+    kDelta = 1,
+    kParent = 2
+  };
+
+  struct BlockHeader {
+    uint32_t kind;
+    uint32_t count;
+    // The size of the block, including this header.
+    uint64_t bytes;
+  };
+
+  struct ColumnHeader {
+    uint8_t mode;
+    uint8_t width;
+    uint16_t padding;
+    uint32_t base;
+  };
+
+  static void encode(unsigned kind, const Entry* ops, uint64_t count, unsigned arity, std::vector<unsigned char>& out) {
+  // Encode a batch into `out`. `arity` is the one of the generating tree, if any, and enables `kParent`.
+  // The block stores `count` in 32 bits, so larger batches have to be rejected by the caller, as `WorkloadWriter` does.
+    assert(count <= UINT32_MAX);
+    out.clear();
+    BlockHeader block{kind, static_cast<uint32_t>(count), 0};
+    append(out, &block, sizeof(block));
+    std::vector<uint32_t> values(count);
+    for (uint64_t index = 0; index != count; ++index)
+      values[index] = ops[index].first;
+    encodeColumn(values, nullptr, 0, out);
+    for (uint64_t index = 0; index != count; ++index)
+      values[index] = ops[index].second;
+    encodeColumn(values, ops, arity, out);
+    block.bytes = out.size();
+    std::memcpy(out.data(), &block, sizeof(block));
+  }
+
+  static void decode(const unsigned char* block, unsigned arity, Entry* out) {
+  // Decode the batch of `block` into `out`, which has room for its `count` operations.
+    BlockHeader header;
+    std::memcpy(&header, block, sizeof(header));
+    auto column = block + sizeof(BlockHeader);
+    column = decodeColumn<&Entry::first>(column, header.count, arity, out);
+    decodeColumn<&Entry::second>(column, header.count, arity, out);
+  }
+
+  static const char* check(const unsigned char* block, uint64_t available, unsigned arity) {
+  // Check that `block` fits into the `available` bytes and is well-formed. Returns the error, if any.
+    if (available < sizeof(BlockHeader) + 2 * sizeof(ColumnHeader))
+      return "has a truncated block";
+    BlockHeader header;
+    std::memcpy(&header, block, sizeof(header));
+    if ((header.bytes > available) || (header.bytes % 8))
+      return "has a truncated block";
+    uint64_t offset = sizeof(BlockHeader);
+    for (unsigned index = 0; index != 2; ++index) {
+      if (offset + sizeof(ColumnHeader) > header.bytes)
+        return "has a truncated block";
+      ColumnHeader column;
+      std::memcpy(&column, block + offset, sizeof(column));
+      if ((column.mode > kParent) || (column.width > 32) || ((column.mode == kParent) && (!index || !arity)))
+        return "has an invalid block";
+      offset += sizeof(ColumnHeader) + columnBytes(column.width, header.count);
+    }
+    if (offset != header.bytes)
+      return "has an invalid block";
+    return nullptr;
+  }
+
+private:
+  static void append(std::vector<unsigned char>& out, const void* data, size_t size) {
+    auto bytes = static_cast<const unsigned char*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+  }
+
+  // The bytes of `count` values of `width` bits, padded to 8 bytes, plus 8 spare bytes.
+  static uint64_t columnBytes(unsigned width, uint64_t count) { return (width * count + 63) / 64 * 8 + 8; }
+
+  static uint32_t zigzag(uint32_t delta) { return (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31); }
+  static uint32_t unzigzag(uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+  static unsigned bitWidth(uint32_t value) { return value ? 32 - __builtin_clz(value) : 0; }
+  static uint32_t parentOf(uint32_t u, unsigned arity) { return u ? (u - 1) / arity : 0; }
+
+  static void encodeColumn(std::vector<uint32_t>& values, const Entry* ops, unsigned arity, std::vector<unsigned char>& out) {
+  // Encode `values` with the narrowest mode. `ops` is only given for the `v`s. The differences wrap around modulo 2^32.
+    ColumnHeader column{kFrame, 0, 0, 0};
+    uint32_t count = values.size();
+    if (count) {
+      uint32_t lowest = *std::min_element(values.begin(), values.end());
+      uint32_t frame = 0, delta = 0, parent = 0;
+      for (uint32_t index = 0; index != count; ++index) {
+        frame |= values[index] - lowest;
+        delta |= zigzag(values[index] - (index ? values[index - 1] : values[0]));
+        if (ops && arity)
+          parent |= zigzag(values[index] - parentOf(ops[index].first, arity));
+      }
+      column.width = bitWidth(frame);
+      column.base = lowest;
+      if (bitWidth(delta) < column.width) {
+        column.mode = kDelta;
+        column.width = bitWidth(delta);
+        column.base = values[0];
+      }
+      if (ops && arity && (bitWidth(parent) < column.width)) {
+        column.mode = kParent;
+        column.width = bitWidth(parent);
+        column.base = 0;
+      }
+      for (uint32_t index = count; index--;) {
+        if (column.mode == kFrame)
+          values[index] -= lowest;
+        else if (column.mode == kDelta)
+          values[index] = zigzag(values[index] - (index ? values[index - 1] : values[0]));
+        else
+          values[index] = zigzag(values[index] - parentOf(ops[index].first, arity));
+      }
+    }
+    append(out, &column, sizeof(column));
+
+    // Pack the values, least significant bits first.
+    auto offset = out.size();
+    out.resize(offset + columnBytes(column.width, count), 0);
+    uint64_t bit = 0;
+    for (uint32_t index = 0; index != count; ++index, bit += column.width) {
+      uint64_t word;
+      std::memcpy(&word, out.data() + offset + bit / 8, 8);
+      word |= static_cast<uint64_t>(values[index]) << (bit % 8);
+      std::memcpy(out.data() + offset + bit / 8, &word, 8);
+    }
+  }
+
+  template <unsigned Entry::*kField>
+  static const unsigned char* decodeColumn(const unsigned char* column, uint32_t count, unsigned arity, Entry* out) {
+  // Decode a column into the field `kField` of `out` and return the next column.
+    ColumnHeader header;
+    std::memcpy(&header, column, sizeof(header));
+    auto data = column + sizeof(ColumnHeader);
+    uint64_t mask = (1ull << header.width) - 1;
+
+    // Each value is a single unaligned load, a shift and a mask, i.e., there are no branches on the width.
+    auto unpack = [&](uint32_t index) -> uint32_t {
+      uint64_t bit = static_cast<uint64_t>(index) * header.width, word;
+      std::memcpy(&word, data + bit / 8, 8);
+      return (word >> (bit % 8)) & mask;
+    };
+    if (header.mode == kFrame) {
+      for (uint32_t index = 0; index != count; ++index)
+        out[index].*kField = header.base + unpack(index);
+    } else if (header.mode == kDelta) {
+      uint32_t value = header.base;
+      for (uint32_t index = 0; index != count; ++index)
+        out[index].*kField = value += unzigzag(unpack(index));
+    } else {
+      for (uint32_t index = 0; index != count; ++index)
+        out[index].*kField = parentOf(out[index].first, arity) + unzigzag(unpack(index));
+    }
+    return data + columnBytes(header.width, count);
+  }
+};
+#endif
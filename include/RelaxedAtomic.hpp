@@ -0,0 +1,45 @@
+#ifndef RELAXED_ATOMIC_HPP
+#define RELAXED_ATOMIC_HPP
+#include <atomic>
+
+// An atomic which is loaded with `kLoadOrder` and stored with `kStoreOrder`, but reads like a plain variable.
+template <class T, std::memory_order kLoadOrder, std::memory_order kStoreOrder>
+class OrderedAtomic {
+  std::atomic<T> value_;
+
+public:
+  OrderedAtomic(T value = T()) : value_(value) {}
+  OrderedAtomic(const OrderedAtomic& other) : value_(other.load()) {}
+
+  OrderedAtomic& operator=(const OrderedAtomic& other) {
+    store(other.load());
+    return *this;
+  }
+
+  OrderedAtomic& operator=(T value) {
+    store(value);
+    return *this;
+  }
+
+  T load() const { return value_.load(kLoadOrder); }
+  void store(T value) { value_.store(value, kStoreOrder); }
+
+  operator T() const { return load(); }
+  T operator->() const { return load(); }
+};
+
+// An atomic with relaxed ordering. It is used for the links of `ConcurrentLinkCutTrees::CoNode`:
+// - Writers hold the latch of the preferred path, whose acquire and release already order their accesses.
+// - Optimistic readers (`optimisticWalk`) only need the loads to be atomic, i.e., neither torn nor fused.
+//   They synchronize through the seqlock versions, which carry the acquire and release orderings (see `beginWrite`).
+// On x86-64 and AArch64, a relaxed load or store is a plain `mov` or `ldr` / `str`.
+template <class T>
+using RelaxedAtomic = OrderedAtomic<T, std::memory_order_relaxed, std::memory_order_relaxed>;
+
+// An atomic which is stored with release and loaded with acquire ordering. It is used for the π-array:
+// a split publishes the new representative without bumping its version, so a reader which observes the new entry
+// has to observe the cut link as well, see `ConcurrentLinkCutTrees::unlinkInPiArray`.
+// On x86-64, both are still a plain `mov`; on AArch64, they are `ldar` / `stlr`.
+template <class T>
+using PublishedAtomic = OrderedAtomic<T, std::memory_order_acquire, std::memory_order_release>;
+#endif
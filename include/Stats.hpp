@@ -0,0 +1,180 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Statistics policies for the hot paths of `LinkCutTree` and `ConcurrentLinkCutTrees`, passed as their `Stats` parameter.
+// `NoStats` compiles to nothing. `CountingStats` keeps per-thread counters, which `collect` merges, e.g., once a benchmark ended.
+// The benchmarks enable it with the CMake option `LCT_STATS`.
+#ifndef LCT_STATS
+#define LCT_STATS 0
+#endif
+
+// The counters. `kMax...` ones keep the maximum instead of the sum.
+enum StatsCounter : unsigned {
+  // Restructuring: the rotations and splays, and the number of rotations of the deepest splay.
+  kRotations,
+  kSplays,
+  kMaxSplayRotations,
+  // `expose` / `pathExpose`: the calls, the preferred paths joined, and the preferred children replaced.
+  kExposes,
+  kPathsJoined,
+  kPathSwitches,
+  // `getRepr`: the walks, the hops taken with the shortcuts, and the hops along the π-array only.
+  kReprWalks,
+  kReprHops,
+  kChainHops,
+  // `pathExpose` retries a latch after the representative changed while waiting for it.
+  kRestarts,
+  // The latches taken, the ones which were held by another thread, and the time spent waiting for those.
+  kLatchAcquires,
+  kLatchContended,
+  kLatchWaitNs,
+  // The attempts of `exposePair` which had to release everything, since a latch of the second node was taken.
+  kPairRetries,
+  // The latch-free lookups which succeeded, and the ones which fell back to the latches.
+  kOptimisticHits,
+  kOptimisticMisses,
+  kNumStatsCounters
+};
+
+static inline const char* statsCounterName(unsigned counter) {
+  static const char* names[kNumStatsCounters] = {
+    "rotations", "splays", "maxSplayRotations",
+    "exposes", "pathsJoined", "pathSwitches",
+    "reprWalks", "reprHops", "chainHops",
+    "restarts",
+    "latchAcquires", "latchContended", "latchWaitNs",
+    "pairRetries",
+    "optimisticHits", "optimisticMisses"
+  };
+  return names[counter];
+}
+
+// The merged counters.
+struct StatsSnapshot {
+  uint64_t counters[kNumStatsCounters] = {};
+
+  uint64_t operator[](StatsCounter counter) const { return counters[counter]; }
+
+  void merge(const uint64_t* other) {
+    for (unsigned index = 0; index != kNumStatsCounters; ++index)
+      counters[index] = (index == kMaxSplayRotations) ? std::max(counters[index], other[index]) : (counters[index] + other[index]);
+  }
+
+  std::string toJson() const {
+  // A flat JSON object, e.g., {"rotations": 12, ...}.
+    std::ostringstream out;
+    out << "{";
+    for (unsigned index = 0; index != kNumStatsCounters; ++index)
+      out << (index ? ", " : "") << "\"" << statsCounterName(index) << "\": " << counters[index];
+    out << "}";
+    return out.str();
+  }
+};
+
+// The default: no statistics. All calls are empty and inlined away, and the trees skip the code which only feeds the counters.
+struct NoStats {
+  static constexpr bool kEnabled = false;
+
+  static void add(StatsCounter, uint64_t = 1) {}
+  static void max(StatsCounter, uint64_t) {}
+};
+
+// Per-thread counters. Each thread owns a block on its own cache lines, which only it writes, so an update is a plain load and store.
+// The blocks are registered globally, so that `collect` and `reset` reach the threads which are still alive, e.g., idle workers.
+// Both must only be called while no thread updates the counters, e.g., between the phases of a `WorkerPool`.
+class CountingStats {
+public:
+  static constexpr bool kEnabled = true;
+
+  static void add(StatsCounter counter, uint64_t value = 1) {
+    auto& slot = local().counters[counter];
+    slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  static void max(StatsCounter counter, uint64_t value) {
+    auto& slot = local().counters[counter];
+    if (value > slot.load(std::memory_order_relaxed))
+      slot.store(value, std::memory_order_relaxed);
+  }
+
+  static StatsSnapshot collect() {
+  // The counters of all threads, including the ones which exited.
+    auto& registry = CountingStats::registry();
+    std::unique_lock lock(registry.mutex);
+    StatsSnapshot snapshot;
+    snapshot.merge(registry.retired);
+    for (auto block : registry.blocks) {
+      uint64_t counters[kNumStatsCounters];
+      block->load(counters);
+      snapshot.merge(counters);
+    }
+    return snapshot;
+  }
+
+  static void reset() {
+    auto& registry = CountingStats::registry();
+    std::unique_lock lock(registry.mutex);
+    std::fill(registry.retired, registry.retired + kNumStatsCounters, 0);
+    for (auto block : registry.blocks)
+      for (auto& slot : block->counters)
+        slot.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  struct alignas(64) Block {
+    std::atomic<uint64_t> counters[kNumStatsCounters] = {};
+
+    void load(uint64_t* out) const {
+      for (unsigned index = 0; index != kNumStatsCounters; ++index)
+        out[index] = counters[index].load(std::memory_order_relaxed);
+    }
+  };
+
+  struct Registry {
+    std::mutex mutex;
+    std::vector<Block*> blocks;
+    // The merged counters of the threads which exited.
+    uint64_t retired[kNumStatsCounters] = {};
+  };
+
+  // The block of a thread. It registers on the first update of the thread and retires when the thread exits.
+  struct Local {
+    Block block;
+
+    Local() {
+      auto& registry = CountingStats::registry();
+      std::unique_lock lock(registry.mutex);
+      registry.blocks.push_back(&block);
+    }
+
+    ~Local() {
+      auto& registry = CountingStats::registry();
+      std::unique_lock lock(registry.mutex);
+      StatsSnapshot snapshot;
+      snapshot.merge(registry.retired);
+      uint64_t counters[kNumStatsCounters];
+      block.load(counters);
+      snapshot.merge(counters);
+      std::copy(snapshot.counters, snapshot.counters + kNumStatsCounters, registry.retired);
+      registry.blocks.erase(std::find(registry.blocks.begin(), registry.blocks.end(), &block));
+    }
+  };
+
+  static Block& local() {
+    static thread_local Local local;
+    return local.block;
+  }
+
+  static Registry& registry() {
+    static Registry registry;
+    return registry;
+  }
+};
+#endif
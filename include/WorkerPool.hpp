@@ -0,0 +1,125 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "Numa.hpp"
+
+// A pool of persistent worker threads, which execute batches in phases.
+// `run` hands the same task to every worker and returns once all of them finished it (phase barrier).
+// Thus, the threads are created once and not once per batch.
+class WorkerPool {
+public:
+  explicit WorkerPool(unsigned numThreads, std::vector<int> cpus = {})
+  // The constructor. If `cpus` is given, worker `i` is pinned to `cpus[i]` (see `NumaTopology::assignCpus`).
+  : cpus_(std::move(cpus))
+  {
+    cpus_.resize(numThreads, -1);
+    workers_.reserve(numThreads);
+    for (unsigned index = 0; index != numThreads; ++index)
+      workers_.emplace_back([this, index]() { work(index); });
+  }
+
+  ~WorkerPool()
+  // The destructor.
+  {
+    {
+      std::unique_lock lock(mutex_);
+      stop_.store(true, std::memory_order_relaxed);
+      generation_.fetch_add(1, std::memory_order_release);
+    }
+    start_.notify_all();
+    for (auto& worker : workers_)
+      worker.join();
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // The number of workers.
+  unsigned size() const { return workers_.size(); }
+  // The CPU of each worker, or -1 if not pinned.
+  const std::vector<int>& cpus() const { return cpus_; }
+
+  template <class Task>
+  void run(Task&& task) {
+  // Run `task(workerId)` on all workers and wait until every worker is done.
+    if (workers_.empty())
+      return;
+
+    // Publish the task. The workers read it only after observing the new generation.
+    context_ = &task;
+    invoke_ = [](void* context, unsigned workerId) { (*static_cast<std::remove_reference_t<Task>*>(context))(workerId); };
+    pending_.store(workers_.size(), std::memory_order_relaxed);
+    {
+      std::unique_lock lock(mutex_);
+      generation_.fetch_add(1, std::memory_order_release);
+    }
+    start_.notify_all();
+
+    // Phase barrier.
+    for (unsigned spin = 0; spin != kSpinLimit; ++spin) {
+      if (!pending_.load(std::memory_order_acquire))
+        return;
+      std::this_thread::yield();
+    }
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [&]() { return !pending_.load(std::memory_order_acquire); });
+  }
+
+private:
+  // The number of polls before a thread blocks on a condition variable.
+  // Consecutive batches are usually short, so a worker is likely to be woken up soon.
+  static constexpr unsigned kSpinLimit = 1u << 10;
+
+  // The workers.
+  std::vector<std::thread> workers_;
+  // The CPU of each worker.
+  std::vector<int> cpus_;
+  // The current phase. It is incremented for each task and once more at shutdown.
+  std::atomic<uint64_t> generation_ = 0;
+  // The number of workers which did not yet finish the current task.
+  std::atomic<unsigned> pending_ = 0;
+  // The current task.
+  void* context_ = nullptr;
+  void (*invoke_)(void*, unsigned) = nullptr;
+  // Whether the pool shuts down.
+  std::atomic<bool> stop_ = false;
+  std::mutex mutex_;
+  std::condition_variable start_, done_;
+
+  void work(unsigned workerId) {
+  // The loop of a worker.
+    NumaTopology::pinCurrentThread(cpus_[workerId]);
+    uint64_t seen = 0;
+    while (true) {
+      // Wait for the next phase.
+      uint64_t current = generation_.load(std::memory_order_acquire);
+      for (unsigned spin = 0; (current == seen) && (spin != kSpinLimit); ++spin) {
+        std::this_thread::yield();
+        current = generation_.load(std::memory_order_acquire);
+      }
+      if (current == seen) {
+        std::unique_lock lock(mutex_);
+        start_.wait(lock, [&]() { return generation_.load(std::memory_order_acquire) != seen; });
+        current = generation_.load(std::memory_order_acquire);
+      }
+      seen = current;
+      if (stop_.load(std::memory_order_relaxed))
+        return;
+
+      // Execute the task.
+      invoke_(context_, workerId);
+
+      // The last worker releases the barrier.
+      if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::unique_lock lock(mutex_);
+        done_.notify_one();
+      }
+    }
+  }
+};
+#endif
@@ -0,0 +1,557 @@
+#ifndef WORKLOAD_FILE_HPP
+#define WORKLOAD_FILE_HPP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "PackedCodec.hpp"
+
+// The workload files of the benchmarks.
+// A file starts with a `WorkloadHeader`, followed by the payload: a sequence of batches. All integers are stored little-endian.
+// - `kPlainEncoding`: each batch is a `(kind, count)` entry followed by `count` operations `(u, v)`.
+// - `kPackedEncoding`: each batch is a block of `PackedCodec`.
+
+// A read-only view of `size()` consecutive elements, e.g., of a mapped workload.
+template <class T>
+class Span {
+public:
+  Span() = default;
+  Span(const T* data, uint64_t size) : data_(data), size_(size) {}
+
+  const T* data() const { return data_; }
+  uint64_t size() const { return size_; }
+  bool empty() const { return !size_; }
+
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+  const T& operator[](uint64_t index) const { return data_[index]; }
+
+private:
+  const T* data_ = nullptr;
+  uint64_t size_ = 0;
+};
+
+// The kind of a batch, i.e., of all its operations. Readers must reject kinds they do not know.
+enum OpKind : unsigned {
+  // `(u, root)`: `findRoot(u)` is expected to return `root`.
+  kLookup = 0,
+  // `(u, v)`: `link(u, v)`, where `u` is a root.
+  kLink = 1,
+  // `(u, v)`: `cut(u)`, where `v` is the parent of `u`.
+  kCut = 2,
+  // Any of the above, with the kind in the top bits of `u` (see `MixedOp`). The operations may run in any order.
+  kMixed = 3,
+  // The number of kinds the header reserves counters for.
+  kMaxOpKinds = 8
+};
+
+// The kind of a workload.
+enum WorkloadKind : uint32_t {
+  // Links and lookups.
+  kLookupWorkload = 0,
+  // Links, lookups and cuts.
+  kCutWorkload = 1,
+  // Links, followed by batches which mix lookups, links and cuts.
+  kMixedWorkload = 2
+};
+
+// The operations of a `kMixed` batch carry their kind in the top two bits of `u`. Thus, such workloads have less than 2^30 vertices.
+struct MixedOp {
+  static constexpr unsigned kShift = 30;
+  static constexpr unsigned kMaxLabel = (1u << kShift) - 1;
+
+  static unsigned encode(OpKind kind, unsigned u) { return (kind << kShift) | u; }
+  static OpKind kind(unsigned u) { return static_cast<OpKind>(u >> kShift); }
+  static unsigned label(unsigned u) { return u & kMaxLabel; }
+};
+
+// The encoding of the payload.
+enum WorkloadEncoding : uint32_t {
+  kPlainEncoding = 0,
+  kPackedEncoding = 1
+};
+
+static inline const char* workloadKindName(uint32_t kind) {
+  switch (kind) {
+    case kLookupWorkload: return "lookup";
+    case kCutWorkload: return "cut";
+    case kMixedWorkload: return "mixed";
+  }
+  return "unknown";
+}
+
+// The header of a workload file. It describes the workload, so that readers do not depend on the file name.
+struct WorkloadHeader {
+  static constexpr char kMagic[8] = {'L', 'C', 'T', 'W', 'L', 'D', '\r', '\n'};
+  // Version 2 added the header to the checksum.
+  static constexpr uint32_t kVersion = 2;
+
+  char magic[8];
+  // The version of the format. Readers reject newer versions.
+  uint32_t version = kVersion;
+  // The size of the header, i.e., the offset of the payload.
+  uint32_t headerSize = sizeof(WorkloadHeader);
+  // The number of vertices. The labels are 32-bit, so readers reject more than `UINT32_MAX`.
+  uint64_t n = 0;
+  // The `WorkloadKind`.
+  uint32_t kind = kLookupWorkload;
+  // The `WorkloadEncoding` of the payload.
+  uint32_t encoding = kPlainEncoding;
+  // The generator parameters: the batch size β, the arity of the tree (0 for a random tree) and the seed.
+  uint64_t batchSize = 0;
+  uint32_t arity = 0;
+  uint32_t reserved0 = 0;
+  uint64_t seed = 0;
+  // The number of operations of each `OpKind`.
+  uint64_t opCounts[kMaxOpKinds] = {};
+  // The number of batches.
+  uint64_t numBatches = 0;
+  // The size of the payload, in bytes.
+  uint64_t payloadBytes = 0;
+  // The checksum of the file, see `workloadChecksum`.
+  uint64_t checksum = 0;
+  // For `kMixedWorkload`, the ratio of lookups, links and cuts in a mixed batch.
+  uint16_t mix[3] = {};
+  uint16_t reserved1[5] = {};
+
+  WorkloadHeader() { std::memcpy(magic, kMagic, sizeof(magic)); }
+
+  // The tree type, as named on the command line of `build_concurrent_workload`.
+  std::string treeType() const { return arity ? std::to_string(arity) + "-ary" : "random"; }
+};
+static_assert(sizeof(WorkloadHeader) == 160, "The header layout is part of the file format.");
+
+// A 64-bit checksum of a byte stream, which can be computed incrementally.
+// It folds the stream in 8-byte little-endian words, so that it runs at several bytes per cycle.
+class Checksum {
+public:
+  void update(const void* data, uint64_t size) {
+    auto bytes = static_cast<const unsigned char*>(data);
+    length_ += size;
+    for (; size && pending_; --size)
+      addByte(*bytes++);
+    for (; size >= 8; size -= 8, bytes += 8) {
+      uint64_t word;
+      std::memcpy(&word, bytes, 8);
+      state_ = mix(state_, word);
+    }
+    for (; size; --size)
+      addByte(*bytes++);
+  }
+
+  uint64_t digest() const {
+    // Fold in the partial word and the length, so that trailing zeros change the checksum.
+    return mix(mix(state_, word_), length_);
+  }
+
+private:
+  uint64_t state_ = 0x243F6A8885A308D3ull;
+  // The partial word and its number of bytes.
+  uint64_t word_ = 0;
+  unsigned pending_ = 0;
+  uint64_t length_ = 0;
+
+  static uint64_t mix(uint64_t state, uint64_t word) {
+    state = (state ^ word) * 0x9E3779B97F4A7C15ull;
+    return state ^ (state >> 29);
+  }
+
+  void addByte(unsigned char byte) {
+    word_ |= static_cast<uint64_t>(byte) << (8 * pending_);
+    if (++pending_ == 8) {
+      state_ = mix(state_, word_);
+      word_ = 0;
+      pending_ = 0;
+    }
+  }
+};
+
+// The checksum of a workload file: the `Checksum` of its header, with the `checksum` field replaced by the one of the payload.
+// Thus, it covers the header, except for the field itself, and the payload.
+static inline uint64_t workloadChecksum(WorkloadHeader header, uint64_t payloadChecksum) {
+  header.checksum = payloadChecksum;
+  Checksum checksum;
+  checksum.update(&header, sizeof(header));
+  return checksum.digest();
+}
+
+// A workload file mapped into memory, i.e., read without copying it.
+class WorkloadFile {
+public:
+  using Entry = std::pair<unsigned, unsigned>;
+  static_assert(sizeof(Entry) == 2 * sizeof(unsigned), "The entries are stored without padding.");
+
+  // Hints for the kernel, to be combined with `|`.
+  enum Hint : unsigned {
+    kNoHint = 0,
+    // Fault in all pages while mapping (`MAP_POPULATE`), so that no page fault hits the measured run.
+    kPopulate = 1,
+    // The entries are read front to back (`MADV_SEQUENTIAL`), i.e., read ahead aggressively.
+    kSequential = 2,
+    // The entries are needed soon (`MADV_WILLNEED`), i.e., start reading them in the background.
+    kWillNeed = 4
+  };
+
+  explicit WorkloadFile(const std::string& filename, unsigned hints = kPopulate)
+  // The constructor. Check `isOpen()` before accessing the entries, and `error()` if it failed.
+  {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      error_ = "could not be opened";
+      return;
+    }
+    struct stat info;
+    if (fstat(fd, &info)) {
+      error_ = "could not be inspected";
+    } else if (static_cast<uint64_t>(info.st_size) < sizeof(WorkloadHeader)) {
+      error_ = "has no header";
+    } else {
+      bytes_ = info.st_size;
+      int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+      if (hints & kPopulate)
+        flags |= MAP_POPULATE;
+#endif
+      void* data = mmap(nullptr, bytes_, PROT_READ, flags, fd, 0);
+      if (data == MAP_FAILED) {
+        error_ = "could not be mapped";
+      } else {
+        data_ = data;
+        if (hints & kSequential)
+          madvise(data_, bytes_, MADV_SEQUENTIAL);
+        if (hints & kWillNeed)
+          madvise(data_, bytes_, MADV_WILLNEED);
+        error_ = validate();
+      }
+    }
+    // The mapping outlives the descriptor.
+    close(fd);
+  }
+
+  ~WorkloadFile()
+  // The destructor.
+  {
+    if (data_)
+      munmap(data_, bytes_);
+  }
+
+  WorkloadFile(const WorkloadFile&) = delete;
+  WorkloadFile& operator=(const WorkloadFile&) = delete;
+
+  // Whether the file could be mapped and is a valid workload.
+  bool isOpen() const { return error_.empty(); }
+  // Why the file could not be read.
+  const std::string& error() const { return error_; }
+  // The size of the file in bytes.
+  uint64_t bytes() const { return bytes_; }
+  // The header.
+  const WorkloadHeader& header() const { return *static_cast<const WorkloadHeader*>(data_); }
+  // The number of vertices, which `validate` checked to fit the 32-bit labels.
+  unsigned n() const { return static_cast<unsigned>(header().n); }
+  // The start of the payload.
+  const unsigned char* payload() const { return static_cast<const unsigned char*>(data_) + header().headerSize; }
+  // The entries of the payload. Only for `kPlainEncoding`; use a `WorkloadReader` to read any encoding.
+  Span<Entry> entries() const {
+    auto payload = static_cast<const char*>(data_) + header().headerSize;
+    return Span<Entry>(reinterpret_cast<const Entry*>(payload), header().payloadBytes / sizeof(Entry));
+  }
+
+private:
+  // The mapping.
+  void* data_ = nullptr;
+  uint64_t bytes_ = 0;
+  // Empty, if the file is valid.
+  std::string error_;
+
+  std::string validate() const {
+  // Check the header and the payload against it.
+    auto& header = this->header();
+    static constexpr char kNoMagic[sizeof(header.magic)] = {};
+    if (!std::memcmp(header.magic, kNoMagic, sizeof(header.magic)))
+      return "is incomplete (its generation failed or was interrupted)";
+    if (std::memcmp(header.magic, WorkloadHeader::kMagic, sizeof(header.magic)))
+      return "is not a workload file (regenerate it with build_concurrent_workload)";
+    if (header.version > WorkloadHeader::kVersion)
+      return "has version " + std::to_string(header.version) + ", but only versions up to " + std::to_string(WorkloadHeader::kVersion) + " are supported";
+    if (header.version < WorkloadHeader::kVersion)
+      return "has the outdated version " + std::to_string(header.version) + " (regenerate it with build_concurrent_workload)";
+    // Up to the current version, the payload follows the header immediately, so that the checksum covers all bytes.
+    if (header.headerSize != sizeof(WorkloadHeader))
+      return "has an invalid header size";
+    if (header.encoding > kPackedEncoding)
+      return "has the unsupported encoding " + std::to_string(header.encoding);
+    if ((header.payloadBytes != bytes_ - header.headerSize) || (header.payloadBytes % sizeof(Entry)))
+      return "is truncated";
+    Checksum checksum;
+    checksum.update(payload(), header.payloadBytes);
+    if (workloadChecksum(header, checksum.digest()) != header.checksum)
+      return "is corrupted (checksum mismatch)";
+    if (header.n > UINT32_MAX)
+      return "has " + std::to_string(header.n) + " vertices, but the labels are 32-bit";
+
+    // Every operation has to refer to vertices below `n`, so that the readers can index their nodes with the labels.
+    auto checkOps = [&](unsigned kind, const Entry* ops, uint64_t count) -> std::string {
+      for (uint64_t index = 0; index != count; ++index) {
+        auto [u, v] = ops[index];
+        if (kind == kMixed) {
+          if (MixedOp::kind(u) > kCut)
+            return "has the unknown operation kind " + std::to_string(MixedOp::kind(u)) + " in a mixed batch";
+          u = MixedOp::label(u);
+        }
+        if ((u >= header.n) || (v >= header.n))
+          return "has the operation (" + std::to_string(u) + ", " + std::to_string(v) + "), but only " + std::to_string(header.n) + " vertices";
+      }
+      return "";
+    };
+
+    // Walk the batches, so that readers only see the kinds they know.
+    uint64_t opCounts[kMaxOpKinds] = {}, numBatches = 0;
+    if (header.encoding == kPlainEncoding) {
+      auto entries = this->entries();
+      for (uint64_t index = 0; index != entries.size(); index += 1 + entries[index].second, ++numBatches) {
+        auto [kind, count] = entries[index];
+        if (kind > kMixed)
+          return "has the unknown operation kind " + std::to_string(kind);
+        if (count > entries.size() - index - 1)
+          return "has a truncated batch";
+        if (auto error = checkOps(kind, entries.data() + index + 1, count); !error.empty())
+          return error;
+        opCounts[kind] += count;
+      }
+    } else {
+      std::vector<Entry> ops;
+      for (uint64_t offset = 0; offset != header.payloadBytes; ++numBatches) {
+        if (auto error = PackedCodec::check(payload() + offset, header.payloadBytes - offset, header.arity))
+          return error;
+        PackedCodec::BlockHeader block;
+        std::memcpy(&block, payload() + offset, sizeof(block));
+        if (block.kind > kMixed)
+          return "has the unknown operation kind " + std::to_string(block.kind);
+        ops.resize(block.count);
+        PackedCodec::decode(payload() + offset, header.arity, ops.data());
+        if (auto error = checkOps(block.kind, ops.data(), block.count); !error.empty())
+          return error;
+        opCounts[block.kind] += block.count;
+        offset += block.bytes;
+      }
+    }
+    if ((numBatches != header.numBatches) || !std::equal(opCounts, opCounts + kMaxOpKinds, header.opCounts))
+      return "does not match the operation counts of its header";
+    return "";
+  }
+};
+
+// A batch of a workload, i.e., `ops.size()` operations of the same kind.
+struct WorkloadBatch {
+  OpKind kind;
+  Span<WorkloadFile::Entry> ops;
+};
+
+// Reads the batches of a workload file in order.
+// Plain batches are handed out in place. Packed batches are decoded by a background thread into two alternating buffers,
+// so that the decoding of the next batch overlaps with the execution of the current one.
+class WorkloadReader {
+public:
+  using Entry = WorkloadFile::Entry;
+
+  explicit WorkloadReader(const WorkloadFile& file)
+  // The constructor.
+  : file_(file), packed_(file.header().encoding == kPackedEncoding)
+  {
+    if (packed_)
+      decoder_ = std::thread([this]() { decode(); });
+  }
+
+  ~WorkloadReader()
+  // The destructor.
+  {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    changed_.notify_all();
+    if (decoder_.joinable())
+      decoder_.join();
+  }
+
+  WorkloadReader(const WorkloadReader&) = delete;
+  WorkloadReader& operator=(const WorkloadReader&) = delete;
+
+  bool next(WorkloadBatch& batch) {
+  // Read the next batch, if any. Its operations stay valid until the next call.
+    if (!packed_) {
+      auto entries = file_.entries();
+      if (cursor_ == entries.size())
+        return false;
+      auto [kind, count] = entries[cursor_];
+      batch = {static_cast<OpKind>(kind), Span<Entry>(entries.data() + cursor_ + 1, count)};
+      cursor_ += 1 + count;
+      return true;
+    }
+    if (cursor_ == file_.header().numBatches)
+      return false;
+
+    // Release the buffer of the previous batch to the decoder and wait for the current one.
+    {
+      std::unique_lock lock(mutex_);
+      released_ = cursor_;
+      changed_.notify_all();
+      changed_.wait(lock, [&]() { return decoded_ > cursor_; });
+    }
+    auto& slot = slots_[cursor_ % 2];
+    batch = {slot.kind, Span<Entry>(slot.ops.data(), slot.count)};
+    ++cursor_;
+    return true;
+  }
+
+private:
+  // A decoded batch.
+  struct Slot {
+    OpKind kind = kLookup;
+    uint64_t count = 0;
+    std::vector<Entry> ops;
+  };
+
+  const WorkloadFile& file_;
+  // Whether the batches need to be decoded.
+  bool packed_;
+  // The position of the next batch: an entry index if plain, a batch index if packed.
+  uint64_t cursor_ = 0;
+  // The buffers of the decoder. Batch `i` is decoded into `slots_[i % 2]`.
+  Slot slots_[2];
+  // The handoff between the reader and the decoder. Both block on `changed_` instead of spinning,
+  // so that a waiting decoder does not compete with the benchmark for the cores.
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  // The number of batches decoded.
+  uint64_t decoded_ = 0;
+  // The number of batches whose buffers the reader released.
+  uint64_t released_ = 0;
+  // Whether the reader is destroyed.
+  bool stop_ = false;
+  std::thread decoder_;
+
+  void decode() {
+  // The loop of the decoder.
+    auto& header = file_.header();
+    uint64_t offset = 0;
+    for (uint64_t index = 0; index != header.numBatches; ++index) {
+      // Wait until the batch which last used the buffer, i.e., `index - 2`, is released.
+      {
+        std::unique_lock lock(mutex_);
+        changed_.wait(lock, [&]() { return stop_ || (released_ + 1 >= index); });
+        if (stop_)
+          return;
+      }
+      auto block = file_.payload() + offset;
+      PackedCodec::BlockHeader blockHeader;
+      std::memcpy(&blockHeader, block, sizeof(blockHeader));
+      auto& slot = slots_[index % 2];
+      slot.kind = static_cast<OpKind>(blockHeader.kind);
+      slot.count = blockHeader.count;
+      if (slot.ops.size() < slot.count)
+        slot.ops.resize(slot.count);
+      PackedCodec::decode(block, header.arity, slot.ops.data());
+      offset += blockHeader.bytes;
+      {
+        std::lock_guard lock(mutex_);
+        decoded_ = index + 1;
+      }
+      changed_.notify_all();
+    }
+  }
+};
+
+// Writes a workload file batch by batch, i.e., without holding the workload in memory.
+// The header is written last, once the counters and the checksum are known.
+class WorkloadWriter {
+public:
+  WorkloadWriter(const std::string& filename, const WorkloadHeader& header)
+  // The constructor. The counters and the checksum of `header` are filled in by `finish`.
+  : header_(header), output_(std::fopen(filename.c_str(), "wb"))
+  {
+    // Reserve the space of the header. Until `finish`, it has no magic, so that an interrupted file is rejected.
+    WorkloadHeader placeholder;
+    std::memset(placeholder.magic, 0, sizeof(placeholder.magic));
+    placeholder.version = 0;
+    if (output_)
+      std::fwrite(&placeholder, sizeof(placeholder), 1, output_);
+  }
+
+  ~WorkloadWriter()
+  // The destructor.
+  {
+    finish();
+  }
+
+  WorkloadWriter(const WorkloadWriter&) = delete;
+  WorkloadWriter& operator=(const WorkloadWriter&) = delete;
+
+  // Whether the file could be created.
+  bool isOpen() const { return output_; }
+
+  template <class Pair>
+  void append(OpKind kind, const Pair* ops, uint64_t count) {
+  // Append a batch of `count` operations of `kind`.
+    static_assert(sizeof(Pair) == sizeof(WorkloadFile::Entry), "The operations are stored as two 32-bit integers.");
+    // Both encodings store the size of a batch in 32 bits; the totals in the header are 64-bit.
+    if (count > UINT32_MAX) {
+      std::cerr << "A batch of " << count << " operations exceeds the limit of " << UINT32_MAX << " per batch." << std::endl;
+      exit(-1);
+    }
+    if (header_.encoding == kPackedEncoding) {
+      PackedCodec::encode(kind, reinterpret_cast<const PackedCodec::Entry*>(ops), count, header_.arity, block_);
+      write(block_.data(), block_.size());
+    } else {
+      WorkloadFile::Entry batch(kind, static_cast<uint32_t>(count));
+      write(&batch, sizeof(batch));
+      write(ops, count * sizeof(Pair));
+    }
+    header_.opCounts[kind] += count;
+    ++header_.numBatches;
+  }
+
+  bool finish() {
+  // Write the header and close the file. Returns whether all writes succeeded.
+    if (!output_)
+      return false;
+    header_.payloadBytes = payloadBytes_;
+    header_.checksum = workloadChecksum(header_, checksum_.digest());
+    bool ok = !std::fseek(output_, 0, SEEK_SET) && (std::fwrite(&header_, sizeof(header_), 1, output_) == 1) && !std::ferror(output_);
+    ok &= !std::fclose(output_);
+    output_ = nullptr;
+    return ok;
+  }
+
+  // The header, as written so far.
+  const WorkloadHeader& header() const { return header_; }
+
+private:
+  WorkloadHeader header_;
+  std::FILE* output_;
+  Checksum checksum_;
+  uint64_t payloadBytes_ = 0;
+  // The block being encoded.
+  std::vector<unsigned char> block_;
+
+  void write(const void* data, uint64_t size) {
+    if (!output_)
+      return;
+    std::fwrite(data, 1, size, output_);
+    checksum_.update(data, size);
+    payloadBytes_ += size;
+  }
+};
+#endif
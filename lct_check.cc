@@ -0,0 +1,451 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "include/ConcurrentLCT.hpp"
+#include "include/LCT.hpp"
+#include "include/Latches.hpp"
+#include "include/LockCouplingLCT.hpp"
+#include "include/Monoids.hpp"
+#include "include/Stats.hpp"
+#include "include/WorkerPool.hpp"
+#include "include/WorkloadFile.hpp"
+
+// Checks of the operations which the benchmarks do not exercise, against a brute force or the roots stored in a workload.
+// Each check exits with -1 at the first mismatch.
+
+void fail(const std::string& check, const std::string& message) {
+  std::cerr << check << ": " << message << std::endl;
+  exit(-1);
+}
+
+// A forest as a parent array, with a weight per node.
+template <class Monoid>
+class BruteForest {
+public:
+  static constexpr unsigned nil = ~0u;
+  using Weight = typename Monoid::Type;
+
+  explicit BruteForest(unsigned n) : parent_(n, nil), weights_(n, Monoid::identity()) {}
+
+  unsigned parent(unsigned x) const { return parent_[x]; }
+
+  unsigned findRoot(unsigned x) const {
+    while (parent_[x] != nil)
+      x = parent_[x];
+    return x;
+  }
+
+  void evert(unsigned x) {
+  // Make `x` the root of its tree by reversing the path from the root to `x`.
+    for (unsigned prev = nil, curr = x; curr != nil;) {
+      auto next = parent_[curr];
+      parent_[curr] = prev;
+      prev = curr;
+      curr = next;
+    }
+  }
+
+  void link(unsigned x, unsigned y) {
+    evert(x);
+    parent_[x] = y;
+  }
+
+  void cut(unsigned x) { parent_[x] = nil; }
+  void setWeight(unsigned x, Weight weight) { weights_[x] = weight; }
+
+  Weight pathAggregate(unsigned x) const {
+  // The weights on the path from the root to `x`, combined in this order.
+    std::vector<unsigned> path;
+    for (; x != nil; x = parent_[x])
+      path.push_back(x);
+    auto aggregate = Monoid::identity();
+    for (unsigned index = path.size(); index--;)
+      aggregate = Monoid::combine(aggregate, weights_[path[index]]);
+    return aggregate;
+  }
+
+private:
+  std::vector<unsigned> parent_;
+  std::vector<Weight> weights_;
+};
+
+// `LinkCutTree` over the labels.
+template <class Monoid>
+class PointerForest {
+  using Tree = LinkCutTree<Monoid>;
+  Tree lct_;
+  std::vector<typename Tree::Node*> nodes_;
+
+public:
+  static constexpr const char* kName = "pointer";
+  static constexpr bool kConcurrent = false;
+
+  explicit PointerForest(unsigned n) : nodes_(n)
+  // The constructor.
+  {
+    for (unsigned index = 0; index != n; ++index) {
+      nodes_[index] = new typename Tree::Node();
+      nodes_[index]->value = index;
+    }
+  }
+
+  ~PointerForest() {
+    for (auto node : nodes_)
+      delete node;
+  }
+
+  void link(unsigned x, unsigned y) { lct_.link(nodes_[x], nodes_[y]); }
+  void cut(unsigned x) { lct_.cut(nodes_[x]); }
+  unsigned findRoot(unsigned x) { return lct_.findRoot(nodes_[x])->value; }
+  void setWeight(unsigned x, typename Monoid::Type weight) { lct_.setWeight(nodes_[x], weight); }
+  typename Monoid::Type pathAggregate(unsigned x) { return lct_.pathAggregate(nodes_[x]); }
+};
+
+// `ConcurrentLinkCutTrees` over the labels.
+template <class Monoid, bool kLockCoupling = false>
+class ConcurrentForest {
+public:
+  using Tree = ConcurrentLinkCutTrees<std::mutex, kLockCoupling, Monoid>;
+
+private:
+  std::vector<typename Tree::CoNode*> nodes_;
+  Tree lct_;
+
+public:
+  static constexpr const char* kName = kLockCoupling ? "lock-coupling" : "fine-grained";
+  static constexpr bool kConcurrent = true;
+
+  explicit ConcurrentForest(unsigned n) : nodes_(n), lct_(n, nodes_)
+  // The constructor.
+  {
+    for (unsigned index = 0; index != n; ++index) {
+      nodes_[index] = new typename Tree::CoNode();
+      nodes_[index]->label = index;
+    }
+  }
+
+  ~ConcurrentForest() {
+    for (auto node : nodes_)
+      delete node;
+  }
+
+  void link(unsigned x, unsigned y) { lct_.link(nodes_[x], nodes_[y]); }
+  void cut(unsigned x) { lct_.cut(nodes_[x]); }
+  unsigned findRoot(unsigned x) { return lct_.findRoot(nodes_[x])->label; }
+  void setWeight(unsigned x, typename Monoid::Type weight) { lct_.setWeight(nodes_[x], weight); }
+  typename Monoid::Type pathAggregate(unsigned x) { return lct_.pathAggregate(nodes_[x]); }
+};
+
+template <class Forest, class Monoid>
+void checkAggregates(const std::string& monoid, unsigned n, unsigned numOps, unsigned seed) {
+// Run random links (of arbitrary nodes, i.e., with evert), cuts, weight updates and path aggregates, and compare with `BruteForest`.
+// Then, if the forest is concurrent, all threads query the path aggregates of the final forest at once.
+  auto check = std::string("aggregates/") + Forest::kName + "/" + monoid;
+  Forest forest(n);
+  BruteForest<Monoid> brute(n);
+  std::mt19937 gen(seed);
+  auto node = [&]() { return std::uniform_int_distribution<unsigned>(0, n - 1)(gen); };
+  auto weight = [&]() { return static_cast<typename Monoid::Type>(std::uniform_int_distribution<int>(-1000, 1000)(gen)); };
+  for (unsigned index = 0; index != numOps; ++index) {
+    auto x = node();
+    switch (std::uniform_int_distribution<unsigned>(0, 4)(gen)) {
+      case 0: {
+        auto y = node();
+        if (brute.findRoot(x) != brute.findRoot(y)) {
+          forest.link(x, y);
+          brute.link(x, y);
+        }
+        break;
+      }
+      case 1:
+        if (brute.parent(x) != BruteForest<Monoid>::nil) {
+          forest.cut(x);
+          brute.cut(x);
+        }
+        break;
+      case 2: {
+        auto w = weight();
+        forest.setWeight(x, w);
+        brute.setWeight(x, w);
+        break;
+      }
+      case 3:
+        if (forest.findRoot(x) != brute.findRoot(x))
+          fail(check, "findRoot(" + std::to_string(x) + ") after " + std::to_string(index) + " operations");
+        break;
+      default:
+        if (forest.pathAggregate(x) != brute.pathAggregate(x))
+          fail(check, "pathAggregate(" + std::to_string(x) + ") after " + std::to_string(index) + " operations");
+    }
+  }
+
+  if constexpr (!Forest::kConcurrent) {
+    std::cerr << check << ": ok" << std::endl;
+    return;
+  }
+  std::vector<typename Monoid::Type> expected(n);
+  for (unsigned x = 0; x != n; ++x)
+    expected[x] = brute.pathAggregate(x);
+  unsigned numThreads = std::max(std::thread::hardware_concurrency(), 2u);
+  WorkerPool pool(numThreads);
+  std::atomic<unsigned> mismatches = 0;
+  pool.run([&](unsigned workerId) {
+    std::mt19937 gen(seed + workerId + 1);
+    for (unsigned index = 0; index != numOps / numThreads; ++index) {
+      auto x = std::uniform_int_distribution<unsigned>(0, n - 1)(gen);
+      if (forest.pathAggregate(x) != expected[x])
+        ++mismatches;
+    }
+  });
+  if (mismatches.load())
+    fail(check, std::to_string(mismatches.load()) + " concurrent path aggregates differ");
+  std::cerr << check << ": ok" << std::endl;
+}
+
+template <class Forest>
+void checkAllAggregates(unsigned n, unsigned numOps, unsigned seed) {
+  checkAggregates<typename Forest::template With<SumMonoid<int64_t>>, SumMonoid<int64_t>>("sum", n, numOps, seed);
+  checkAggregates<typename Forest::template With<MinMonoid<int>>, MinMonoid<int>>("min", n, numOps, seed);
+  checkAggregates<typename Forest::template With<MaxMonoid<int>>, MaxMonoid<int>>("max", n, numOps, seed);
+}
+
+// The forests, instantiated per monoid.
+struct PointerForests {
+  template <class Monoid>
+  using With = PointerForest<Monoid>;
+};
+
+template <bool kLockCoupling>
+struct ConcurrentForests {
+  template <class Monoid>
+  using With = ConcurrentForest<Monoid, kLockCoupling>;
+};
+
+template <class Tree>
+void checkQueries(const std::string& check, const WorkloadFile& file, unsigned numThreads, unsigned rounds) {
+// Run the workload on all threads, with `connected` and `lca` in place of `findRoot`, and compare them with the stored roots.
+// A lookup `(u, root)` expects `connected(u, root)` and `lca(u, root) == root`. Each worker also pairs it with its previous lookup
+// `(w, rootOfW)` of the batch: `connected(u, w)` and whether `lca(u, w)` exists follow from the roots.
+// The lookups of a batch target trees which no update of the batch touches, so the expected answers hold at any time,
+// also while the other workers link and cut, e.g., in a mixed batch.
+  unsigned n = file.n();
+  std::vector<typename Tree::CoNode*> nodes(n);
+  WorkerPool pool(numThreads);
+  std::atomic<uint64_t> numQueries = 0, mismatches = 0;
+  auto mismatch = [&](const std::string& query, bool expected) {
+    if (mismatches.fetch_add(1, std::memory_order_relaxed) < 10)
+      std::cerr << check << ": " << query << " should be " << (expected ? "true" : "false") << std::endl;
+  };
+  CountingStats::reset();
+  for (unsigned round = 0; round != rounds; ++round) {
+    Tree lct(n, nodes);
+    for (unsigned index = 0; index != n; ++index) {
+      nodes[index] = new typename Tree::CoNode();
+      nodes[index]->label = index;
+    }
+    WorkloadReader reader(file);
+    for (WorkloadBatch batch; reader.next(batch);) {
+      pool.run([&](unsigned workerId) {
+        auto& ops = batch.ops;
+        bool hasPrevious = false;
+        unsigned w = 0, rootOfW = 0;
+        uint64_t queries = 0;
+        for (uint64_t index = ops.size() * workerId / numThreads, limit = ops.size() * (workerId + 1) / numThreads; index != limit; ++index) {
+          auto kind = batch.kind;
+          unsigned u = ops[index].first, v = ops[index].second;
+          if (kind == kMixed) {
+            kind = MixedOp::kind(u);
+            u = MixedOp::label(u);
+          }
+          if (kind == kLink) {
+            lct.link(nodes[u], nodes[v]);
+            continue;
+          }
+          if (kind == kCut) {
+            lct.cut(nodes[u]);
+            continue;
+          }
+          auto pair = "(" + std::to_string(u) + ", ";
+          if (!lct.connected(nodes[u], nodes[v]))
+            mismatch("connected" + pair + std::to_string(v) + ")", true);
+          if (lct.lca(nodes[u], nodes[v]) != nodes[v])
+            mismatch("lca" + pair + std::to_string(v) + ") == " + std::to_string(v), true);
+          queries += 2;
+          if (hasPrevious) {
+            bool expected = (v == rootOfW);
+            if (lct.connected(nodes[u], nodes[w]) != expected)
+              mismatch("connected" + pair + std::to_string(w) + ")", expected);
+            if (!!lct.lca(nodes[u], nodes[w]) != expected)
+              mismatch("lca" + pair + std::to_string(w) + ") != nullptr", expected);
+            queries += 2;
+          }
+          hasPrevious = true;
+          w = u;
+          rootOfW = v;
+        }
+        numQueries.fetch_add(queries, std::memory_order_relaxed);
+      });
+    }
+    for (auto node : nodes)
+      delete node;
+  }
+  if (mismatches.load())
+    fail(check, std::to_string(mismatches.load()) + " of " + std::to_string(numQueries.load()) + " queries are wrong");
+  auto stats = CountingStats::collect();
+  std::cerr << check << ": ok, " << numQueries.load() << " queries, " << stats[kPairRetries] << " retries of exposePair, "
+            << stats[kOptimisticHits] << " latch-free connected" << std::endl;
+}
+
+template <class Tree>
+void checkSplits(const std::string& check, unsigned n, unsigned numThreads, unsigned numOps, unsigned seed, bool contended = false) {
+// Run latch-free lookups next to splits of preferred paths, on a tree whose shape never changes.
+// The nodes `[0, n)` form a fixed tree rooted at 0, mostly a long path, so that exposures split long preferred paths.
+// Each worker also owns a leaf in `[n, n + numThreads)`, which it links below a random node and cuts again.
+// The leaves neither change the roots nor the ancestors of the fixed nodes, so `findRoot`, `connected` and `lca`
+// of the fixed nodes have the same answer at any time, while `lca`, the links and the cuts keep splitting paths.
+// If `contended`, the tree is small, so that the second exposure of `lca` and `connected` often finds a latch taken.
+// The check then also fails if `exposePair` never released its latches to retry.
+  std::vector<unsigned> parent(n, 0), depth(n, 0);
+  std::mt19937 gen(seed);
+  for (unsigned u = 1; u != n; ++u) {
+    parent[u] = std::uniform_int_distribution<unsigned>(0, 3)(gen) ? (u - 1) : std::uniform_int_distribution<unsigned>(0, u - 1)(gen);
+    depth[u] = depth[parent[u]] + 1;
+  }
+  auto expectedLca = [&](unsigned u, unsigned v) {
+    while (u != v) {
+      if (depth[u] < depth[v])
+        std::swap(u, v);
+      u = parent[u];
+    }
+    return u;
+  };
+
+  std::vector<typename Tree::CoNode*> nodes(n + numThreads);
+  Tree lct(n + numThreads, nodes);
+  for (unsigned index = 0; index != n + numThreads; ++index) {
+    nodes[index] = new typename Tree::CoNode();
+    nodes[index]->label = index;
+  }
+  for (unsigned u = 1; u != n; ++u)
+    lct.link(nodes[u], nodes[parent[u]]);
+
+  CountingStats::reset();
+  WorkerPool pool(numThreads);
+  std::atomic<uint64_t> mismatches = 0;
+  auto mismatch = [&](const std::string& query) {
+    if (mismatches.fetch_add(1, std::memory_order_relaxed) < 10)
+      std::cerr << check << ": " << query << std::endl;
+  };
+  pool.run([&](unsigned workerId) {
+    std::mt19937 gen(seed + workerId + 1);
+    auto node = [&]() { return std::uniform_int_distribution<unsigned>(0, n - 1)(gen); };
+    auto leaf = nodes[n + workerId];
+    for (unsigned index = 0; index != numOps / numThreads; ++index) {
+      auto u = node(), v = node();
+      switch (index % 4) {
+        case 0:
+          if (lct.findRoot(nodes[u]) != nodes[0])
+            mismatch("findRoot(" + std::to_string(u) + ") != 0");
+          break;
+        case 1:
+          if (!lct.connected(nodes[u], nodes[v]))
+            mismatch("connected(" + std::to_string(u) + ", " + std::to_string(v) + ") should be true");
+          break;
+        case 2:
+          if (lct.lca(nodes[u], nodes[v]) != nodes[expectedLca(u, v)])
+            mismatch("lca(" + std::to_string(u) + ", " + std::to_string(v) + ") != " + std::to_string(expectedLca(u, v)));
+          break;
+        default:
+          lct.link(leaf, nodes[u]);
+          lct.cut(leaf);
+      }
+    }
+  });
+  for (auto node : nodes)
+    delete node;
+
+  if (mismatches.load())
+    fail(check, std::to_string(mismatches.load()) + " lookups are wrong");
+  auto stats = CountingStats::collect();
+  if (!stats[kPathSwitches] || !stats[kOptimisticHits])
+    fail(check, "no latch-free lookup ran next to a split");
+  if (contended && !stats[kPairRetries])
+    fail(check, "exposePair never retried, so the contended path did not run");
+  std::cerr << check << ": ok, " << stats[kPathSwitches] << " splits, " << stats[kOptimisticHits] << " latch-free lookups, "
+            << stats[kOptimisticMisses] << " of them retried with latches, " << stats[kPairRetries] << " retries of exposePair" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  std::string mode = (argc >= 2) ? argv[1] : "";
+  if (mode == "aggregates") {
+    if (argc > 5) {
+      std::cerr << "Usage: " << argv[0] << " aggregates [<n:unsigned>] [<ops:unsigned>] [<seed:unsigned>]" << std::endl;
+      exit(-1);
+    }
+    unsigned n = (argc >= 3) ? atoi(argv[2]) : 256;
+    unsigned numOps = (argc >= 4) ? atoi(argv[3]) : 200000;
+    unsigned seed = (argc == 5) ? atoi(argv[4]) : 42;
+    if (!n) {
+      std::cerr << "The forest needs at least one node!" << std::endl;
+      exit(-1);
+    }
+    checkAllAggregates<PointerForests>(n, numOps, seed);
+    checkAllAggregates<ConcurrentForests<false>>(n, numOps, seed);
+    checkAllAggregates<ConcurrentForests<true>>(n, numOps, seed);
+    return 0;
+  }
+  if ((mode == "queries") && (argc >= 3) && (argc <= 5)) {
+    WorkloadFile file(argv[2]);
+    if (!file.isOpen()) {
+      std::cerr << "Workload \"" << argv[2] << "\" " << file.error() << "!" << std::endl;
+      exit(-1);
+    }
+    unsigned numThreads = (argc >= 4) ? atoi(argv[3]) : std::max(std::thread::hardware_concurrency(), 2u);
+    unsigned rounds = (argc == 5) ? atoi(argv[4]) : 3;
+    if (!numThreads) {
+      std::cerr << "The check needs at least one thread!" << std::endl;
+      exit(-1);
+    }
+    checkQueries<ConcurrentLinkCutTrees<std::mutex, false, NoAggregate, CountingStats>>("queries/fine-grained/mutex", file, numThreads, rounds);
+    checkQueries<ConcurrentLinkCutTrees<TTASLatch, false, NoAggregate, CountingStats>>("queries/fine-grained/ttas", file, numThreads, rounds);
+    checkQueries<LockCouplingLinkCutTrees<MCSLatch, NoAggregate, CountingStats>>("queries/lock-coupling/mcs", file, numThreads, rounds);
+    return 0;
+  }
+  if ((mode == "splits") && (argc <= 6)) {
+    unsigned n = (argc >= 3) ? atoi(argv[2]) : 1000;
+    unsigned numThreads = (argc >= 4) ? atoi(argv[3]) : std::max(std::thread::hardware_concurrency(), 4u);
+    unsigned numOps = (argc >= 5) ? atoi(argv[4]) : 400000;
+    unsigned seed = (argc == 6) ? atoi(argv[5]) : 42;
+    if ((n < 2) || !numThreads) {
+      std::cerr << "The check needs at least two nodes and one thread!" << std::endl;
+      exit(-1);
+    }
+    checkSplits<ConcurrentLinkCutTrees<std::mutex, false, NoAggregate, CountingStats>>("splits/fine-grained/mutex", n, numThreads, numOps, seed);
+    checkSplits<ConcurrentLinkCutTrees<TTASLatch, false, NoAggregate, CountingStats>>("splits/fine-grained/ttas", n, numThreads, numOps, seed);
+    checkSplits<ConcurrentLinkCutTrees<std::mutex, false, NoAggregate, CountingStats, true>>("splits/fine-grained/shortcuts", n, numThreads, numOps, seed);
+    checkSplits<LockCouplingLinkCutTrees<MCSLatch, NoAggregate, CountingStats>>("splits/lock-coupling/mcs", n, numThreads, numOps, seed);
+    return 0;
+  }
+  if ((mode == "contention") && (argc <= 5)) {
+    unsigned numThreads = (argc >= 3) ? atoi(argv[2]) : std::max(std::thread::hardware_concurrency(), 8u);
+    unsigned numOps = (argc >= 4) ? atoi(argv[3]) : 400000;
+    unsigned seed = (argc == 5) ? atoi(argv[4]) : 42;
+    if (numThreads < 2) {
+      std::cerr << "The check needs at least two threads!" << std::endl;
+      exit(-1);
+    }
+    static constexpr unsigned kContendedNodes = 16;
+    checkSplits<ConcurrentLinkCutTrees<std::mutex, false, NoAggregate, CountingStats>>("contention/fine-grained/mutex", kContendedNodes, numThreads, numOps, seed, true);
+    checkSplits<ConcurrentLinkCutTrees<TTASLatch, false, NoAggregate, CountingStats>>("contention/fine-grained/ttas", kContendedNodes, numThreads, numOps, seed, true);
+    checkSplits<LockCouplingLinkCutTrees<MCSLatch, NoAggregate, CountingStats>>("contention/lock-coupling/mcs", kContendedNodes, numThreads, numOps, seed, true);
+    return 0;
+  }
+  std::cerr << "Usage: " << argv[0] << " aggregates [<n:unsigned>] [<ops:unsigned>] [<seed:unsigned>]" << std::endl;
+  std::cerr << "       " << argv[0] << " queries <workload:file> [<num_threads:unsigned>] [<rounds:unsigned>]" << std::endl;
+  std::cerr << "       " << argv[0] << " splits [<n:unsigned>] [<num_threads:unsigned>] [<ops:unsigned>] [<seed:unsigned>]" << std::endl;
+  std::cerr << "       " << argv[0] << " contention [<num_threads:unsigned>] [<ops:unsigned>] [<seed:unsigned>]" << std::endl;
+  exit(-1);
+}
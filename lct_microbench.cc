@@ -0,0 +1,402 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "include/ArenaLCT.hpp"
+#include "include/ConcurrentLCT.hpp"
+#include "include/InlineVector.hpp"
+#include "include/LCT.hpp"
+#include "include/Latches.hpp"
+
+using namespace std::chrono;
+
+// Micro-benchmarks of the primitives, in nanoseconds per operation.
+// Each benchmark has a name; a filter restricts the run to the benchmarks whose name contains it.
+
+// Sink for the results, so that the measured code is not optimized away.
+static volatile unsigned sink;
+
+template <class Fn>
+double measure(unsigned iterations, Fn&& fn) {
+// Run `fn(iteration)` `iterations` times and return the time per call in nanoseconds.
+  auto start = high_resolution_clock::now();
+  for (unsigned iteration = 0; iteration != iterations; ++iteration)
+    fn(iteration);
+  auto stop = high_resolution_clock::now();
+  return static_cast<double>(duration_cast<nanoseconds>(stop - start).count()) / iterations;
+}
+
+template <class Fn>
+double measureParallel(unsigned numThreads, unsigned iterations, Fn&& fn) {
+// Run `measure` on `numThreads` threads at once and return the average time per call.
+  std::vector<double> times(numThreads);
+  std::vector<std::thread> threads;
+  for (unsigned index = 0; index != numThreads; ++index)
+    threads.emplace_back([&, index]() { times[index] = measure(iterations, fn); });
+  for (auto& thread : threads)
+    thread.join();
+  double sum = 0;
+  for (auto time : times)
+    sum += time;
+  return sum / numThreads;
+}
+
+template <class Setup, class Fn>
+double measureEach(unsigned iterations, Setup&& setup, Fn&& fn) {
+// Run `setup(iteration)` and then `fn(iteration)` `iterations` times and return the time per call of `fn` in nanoseconds.
+// Only `fn` is timed, e.g., a splay whose input shape is rebuilt by `setup`. It should take microseconds, so that the clock is negligible.
+  nanoseconds total(0);
+  for (unsigned iteration = 0; iteration != iterations; ++iteration) {
+    setup(iteration);
+    auto start = high_resolution_clock::now();
+    fn(iteration);
+    total += duration_cast<nanoseconds>(high_resolution_clock::now() - start);
+  }
+  return static_cast<double>(total.count()) / iterations;
+}
+
+void report(std::string name, double nsPerOp) {
+  std::cout << name << ": " << nsPerOp << " ns/op" << std::endl;
+}
+
+bool selected(const std::string& name, const std::string& filter) {
+// Whether the benchmark `name` passes the filter.
+  return name.find(filter) != std::string::npos;
+}
+
+// The node layouts, behind a common interface over the labels, so that the primitives are measured on each.
+// `LinkCutTree`: nodes allocated one by one, with pointers.
+class PointerLayout {
+  using Tree = LinkCutTree<>;
+  Tree lct_;
+  std::vector<Tree::Node*> nodes_;
+
+public:
+  static constexpr const char* kName = "pointer";
+
+  explicit PointerLayout(unsigned n) : nodes_(n)
+  // The constructor.
+  {
+    for (unsigned index = 0; index != n; ++index) {
+      nodes_[index] = new Tree::Node();
+      nodes_[index]->value = index;
+    }
+  }
+
+  ~PointerLayout() {
+    for (auto node : nodes_)
+      delete node;
+  }
+
+  void link(unsigned x, unsigned y) { lct_.link(nodes_[x], nodes_[y]); }
+  void rotate(unsigned x) { lct_.rotate(nodes_[x]); }
+  void splay(unsigned x) { lct_.splay(nodes_[x]); }
+  void expose(unsigned x) { lct_.expose(nodes_[x]); }
+};
+
+// `ArenaLinkCutTree`: the links as arrays of 32-bit indices.
+class ArenaLayout {
+  ArenaLinkCutTree lct_;
+
+public:
+  static constexpr const char* kName = "arena";
+
+  explicit ArenaLayout(unsigned n) : lct_(n) {}
+
+  void link(unsigned x, unsigned y) { lct_.link(x, y); }
+  void rotate(unsigned x) { lct_.rotate(x); }
+  void splay(unsigned x) { lct_.splay(x); }
+  void expose(unsigned x) { lct_.expose(x); }
+};
+
+// `ConcurrentLinkCutTrees`: nodes with atomic links, a latch and a version. `expose` takes and releases the latches.
+template <class Latch = std::mutex, bool kShortcuts = false>
+class ConcurrentLayout {
+public:
+  using Tree = ConcurrentLinkCutTrees<Latch, false, NoAggregate, NoStats, kShortcuts>;
+
+private:
+  std::vector<typename Tree::CoNode*> nodes_;
+  Tree lct_;
+
+public:
+  static constexpr const char* kName = "concurrent";
+
+  explicit ConcurrentLayout(unsigned n) : nodes_(n), lct_(n, nodes_)
+  // The constructor.
+  {
+    for (unsigned index = 0; index != n; ++index) {
+      nodes_[index] = new typename Tree::CoNode();
+      nodes_[index]->label = index;
+    }
+  }
+
+  ~ConcurrentLayout() {
+    for (auto node : nodes_)
+      delete node;
+  }
+
+  void link(unsigned x, unsigned y) { lct_.link(nodes_[x], nodes_[y]); }
+  void rotate(unsigned x) { lct_.rotate(nodes_[x]); }
+  void splay(unsigned x) { lct_.splay(nodes_[x]); }
+
+  void expose(unsigned x) {
+    auto trace = lct_.pathExpose(nodes_[x]);
+    lct_.unlockTrace(trace);
+  }
+
+  Tree& tree() { return lct_; }
+  typename Tree::CoNode* node(unsigned x) { return nodes_[x]; }
+};
+
+template <class Layout>
+void buildPath(Layout& layout, unsigned n) {
+// Link the nodes into a path: node `i` is the child of `i - 1`, i.e., 0 is the root and `n - 1` the deepest node.
+  for (unsigned index = 1; index != n; ++index)
+    layout.link(index, index - 1);
+}
+
+template <class Layout>
+void makeVine(Layout& layout, unsigned n) {
+// Turn the splay tree of the exposed path into a vine, i.e., a path of splay nodes, with 0 on top and `n - 1` at the bottom.
+// Splaying the nodes in the order of the path does so from any shape (sequential access): each splay hangs the previous root below.
+  for (unsigned index = n; index--;)
+    layout.splay(index);
+}
+
+template <class Layout>
+unsigned makeZigZag(Layout& layout, unsigned n) {
+// Turn the vine of `makeVine` into a zig-zag chain, i.e., the children alternate between left and right. Returns its bottom node.
+// Lifting the bottom of a vine to its top hangs the rest of the vine on the other side, so we lift repeatedly
+// the bottom of the remaining vine: n - 1, 0, n - 2, 1, ... This takes about n^2 / 4 rotations.
+  unsigned lo = 0, hi = n - 1, bottom = 0;
+  for (bool lift = true; lo <= hi; lift = !lift) {
+    if (lift) {
+      for (unsigned index = lo; index != hi; ++index)
+        layout.rotate(hi);
+      bottom = hi--;
+    } else {
+      bottom = lo++;
+    }
+  }
+  return bottom;
+}
+
+template <class Layout>
+void splayBenchmarks(const std::string& filter) {
+// `splay` on controlled shapes of one preferred path of `n` nodes.
+// - `path`: random nodes, i.e., the amortized cost on the splay tree of a path.
+// - `zigzig`: the bottom of a vine, i.e., only zig-zig steps, rebuilt after each splay.
+// - `zigzag`: the bottom of a zig-zag chain, i.e., only zig-zag steps, rebuilt after each splay.
+// The shapes with the bottom splayed take n - 1 rotations, so they are also reported per rotation.
+  const unsigned n = 1u << 10;
+  auto prefix = std::string("splay/") + Layout::kName;
+  Layout layout(n);
+  buildPath(layout, n);
+  layout.expose(n - 1);
+
+  auto name = prefix + "/path/n=" + std::to_string(n);
+  if (selected(name, filter)) {
+    const unsigned iterations = 1u << 20;
+    std::vector<unsigned> queries(iterations);
+    std::mt19937 gen(42);
+    for (auto& query : queries)
+      query = std::uniform_int_distribution<unsigned>(0, n - 1)(gen);
+    report(name, measure(iterations, [&](unsigned iteration) { layout.splay(queries[iteration]); }));
+  }
+
+  name = prefix + "/zigzig/n=" + std::to_string(n);
+  if (selected(name, filter)) {
+    auto time = measureEach(1u << 10, [&](unsigned) { makeVine(layout, n); }, [&](unsigned) { layout.splay(n - 1); });
+    report(name, time);
+    report(name + "/rotation", time / (n - 1));
+  }
+
+  name = prefix + "/zigzag/n=" + std::to_string(n);
+  if (selected(name, filter)) {
+    unsigned bottom = 0;
+    auto time = measureEach(1u << 6, [&](unsigned) { makeVine(layout, n); bottom = makeZigZag(layout, n); }, [&](unsigned) { layout.splay(bottom); });
+    report(name, time);
+    report(name + "/rotation", time / (n - 1));
+  }
+}
+
+template <class Layout>
+void pathBenchmarks(const std::string& filter) {
+// `expose` of the bottom of a path of `n` nodes, which is split into `numPaths` preferred paths of equal length before each call.
+// Thus, it splays and joins `numPaths` preferred paths, e.g., taking as many latches for `ConcurrentLinkCutTrees`.
+  const unsigned n = 1u << 12;
+  auto prefix = std::string("expose/") + Layout::kName;
+  Layout layout(n);
+  buildPath(layout, n);
+  for (unsigned numPaths : {1, 4, 16, 64}) {
+    auto name = prefix + "/paths=" + std::to_string(numPaths) + "/n=" + std::to_string(n);
+    if (!selected(name, filter))
+      continue;
+
+    // Exposing the first node of each preferred path from the bottom up splits off the path below it.
+    auto split = [&](unsigned) {
+      layout.expose(n - 1);
+      for (unsigned index = numPaths - 1; index; --index)
+        layout.expose(static_cast<uint64_t>(n) * index / numPaths - 1);
+    };
+    report(name, measureEach(1u << 10, split, [&](unsigned) { layout.expose(n - 1); }));
+  }
+}
+
+template <class Layout>
+void reprBenchmark(const std::string& name, unsigned length) {
+// `getRepr` of the bottom of a path whose π-array chain has `length` hops.
+// The path is exposed from the top down, so each node is linked in the π-array to its parent.
+  Layout layout(length + 1);
+  buildPath(layout, length + 1);
+  for (unsigned index = 1; index <= length; ++index)
+    layout.expose(index);
+  auto& lct = layout.tree();
+  auto bottom = layout.node(length);
+  report(name, measure(1u << 20, [&](unsigned) { sink = lct.getRepr(bottom); }));
+}
+
+void reprBenchmarks(const std::string& filter) {
+// `getRepr` along the π-array (`plain`) and with the shortcuts installed by the exposures (`shortcuts`),
+// which stay valid as long as the representative does not change.
+  for (unsigned length : {1, 4, 16, 64, 256}) {
+    auto name = "repr/chain=" + std::to_string(length);
+    if (selected(name + "/shortcuts", filter))
+      reprBenchmark<ConcurrentLayout<std::mutex, true>>(name + "/shortcuts", length);
+    if (selected(name + "/plain", filter))
+      reprBenchmark<ConcurrentLayout<>>(name + "/plain", length);
+  }
+}
+
+// A latch on its own cache line.
+template <class Latch>
+struct alignas(64) PaddedLatch {
+  Latch latch;
+};
+
+template <class Latch>
+void latchBenchmarks(const std::string& name, const std::string& filter) {
+// `lock` and `unlock` of a latch: by a single thread, by all threads on their own latches and by all threads on a single one.
+  const unsigned iterations = 1u << 20;
+  unsigned numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  auto prefix = "latch/" + name;
+  if (selected(prefix + "/uncontended", filter)) {
+    PaddedLatch<Latch> latch;
+    report(prefix + "/uncontended", measure(iterations, [&](unsigned) {
+      latch.latch.lock();
+      latch.latch.unlock();
+    }));
+  }
+  auto suffix = "/threads=" + std::to_string(numThreads);
+  if (selected(prefix + "/private" + suffix, filter)) {
+    std::vector<PaddedLatch<Latch>> latches(numThreads);
+    std::vector<std::thread> threads;
+    std::vector<double> times(numThreads);
+    for (unsigned index = 0; index != numThreads; ++index) {
+      threads.emplace_back([&, index]() {
+        auto& latch = latches[index].latch;
+        times[index] = measure(iterations, [&](unsigned) {
+          latch.lock();
+          latch.unlock();
+        });
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    double sum = 0;
+    for (auto time : times)
+      sum += time;
+    report(prefix + "/private" + suffix, sum / numThreads);
+  }
+  if (selected(prefix + "/shared" + suffix, filter)) {
+    PaddedLatch<Latch> latch;
+    report(prefix + "/shared" + suffix, measureParallel(numThreads, iterations, [&](unsigned) {
+      latch.latch.lock();
+      latch.latch.unlock();
+    }));
+  }
+}
+
+template <class TraceType>
+unsigned simulateTrace(unsigned numPaths, unsigned seed) {
+// The life cycle of a trace in `pathExpose`: one entry per preferred path, then unlocked in reverse order.
+  TraceType trace;
+  for (unsigned index = 0; index != numPaths; ++index)
+    trace.push_back(seed + index);
+  unsigned checksum = 0;
+  for (unsigned index = 0, limit = trace.size(); index != limit; ++index)
+    checksum += trace[limit - index - 1];
+  return checksum;
+}
+
+void traceBenchmarks(const std::string& filter) {
+// Compare the heap-allocated trace with the inline one, on one and on all hardware threads.
+  using HeapTrace = std::vector<unsigned>;
+  using Trace = ConcurrentLinkCutTrees<>::Trace;
+  const unsigned iterations = 1u << 20;
+  unsigned numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  for (unsigned numPaths : {2, 8, 32, 64}) {
+    auto suffix = "/paths=" + std::to_string(numPaths);
+    if (selected("trace/vector" + suffix, filter)) {
+      report("trace/vector" + suffix, measure(iterations, [&](unsigned iteration) { sink = simulateTrace<HeapTrace>(numPaths, iteration); }));
+      report("trace/vector" + suffix + "/threads=" + std::to_string(numThreads),
+             measureParallel(numThreads, iterations, [&](unsigned iteration) { sink = simulateTrace<HeapTrace>(numPaths, iteration); }));
+    }
+    if (selected("trace/inline" + suffix, filter)) {
+      report("trace/inline" + suffix, measure(iterations, [&](unsigned iteration) { sink = simulateTrace<Trace>(numPaths, iteration); }));
+      report("trace/inline" + suffix + "/threads=" + std::to_string(numThreads),
+             measureParallel(numThreads, iterations, [&](unsigned iteration) { sink = simulateTrace<Trace>(numPaths, iteration); }));
+    }
+  }
+}
+
+void exposeBenchmarks(const std::string& filter) {
+// `pathExpose` and `unlockTrace` on a random forest, i.e., the per-operation overhead of the latched path.
+  if (!selected("expose/random", filter))
+    return;
+  using CoTree = ConcurrentLinkCutTrees<>;
+  const unsigned n = 1u << 16, iterations = 1u << 20;
+  std::vector<CoTree::CoNode*> nodes(n);
+  CoTree lct(n, nodes);
+  for (unsigned index = 0; index != n; ++index) {
+    nodes[index] = new CoTree::CoNode();
+    nodes[index]->label = index;
+  }
+  std::mt19937 gen(42);
+  for (unsigned index = 1; index != n; ++index)
+    lct.link(nodes[index], nodes[std::uniform_int_distribution<unsigned>(0, index - 1)(gen)]);
+
+  std::vector<unsigned> queries(iterations);
+  for (auto& query : queries)
+    query = std::uniform_int_distribution<unsigned>(0, n - 1)(gen);
+  report("expose/random/n=" + std::to_string(n), measure(iterations, [&](unsigned iteration) {
+    auto trace = lct.pathExpose(nodes[queries[iteration]]);
+    lct.unlockTrace(trace);
+  }));
+  for (auto node : nodes)
+    delete node;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 2) {
+    std::cerr << "Usage: " << argv[0] << " [<filter:string>]" << std::endl;
+    exit(-1);
+  }
+  std::string filter = (argc == 2) ? argv[1] : "";
+  traceBenchmarks(filter);
+  exposeBenchmarks(filter);
+  splayBenchmarks<PointerLayout>(filter);
+  splayBenchmarks<ArenaLayout>(filter);
+  splayBenchmarks<ConcurrentLayout<>>(filter);
+  pathBenchmarks<PointerLayout>(filter);
+  pathBenchmarks<ArenaLayout>(filter);
+  pathBenchmarks<ConcurrentLayout<>>(filter);
+  reprBenchmarks(filter);
+  latchBenchmarks<std::mutex>("mutex", filter);
+  latchBenchmarks<TTASLatch>("ttas", filter);
+  latchBenchmarks<MCSLatch>("mcs", filter);
+}
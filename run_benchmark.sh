@@ -15,19 +15,15 @@ cd build && make -j20
 ./bench ../workloads/cut-random-$3-$1.bin
 
 FS="1-ary 2-ary "$(($1 - 1))"-ary random"
-TS="2 4 8 16 32 48 56 84 112"
+TS="2,4,8,16,32,48,56,84,112"
+KS="8,16,32"
 
 echo 'Benchmarking..'
 echo $FS
 echo $TS
 
+# Each sweep loads its workload once and writes one CSV row per thread count and task factor.
 for F in $FS; do
-  for T in $TS; do
-    ./concurrent_bench ../workloads/cut-$F-$2-$1.bin $T 8
-    ./concurrent_bench ../workloads/cut-$F-$3-$1.bin $T 8
-    ./concurrent_bench ../workloads/cut-$F-$2-$1.bin $T 16
-    ./concurrent_bench ../workloads/cut-$F-$3-$1.bin $T 16
-    ./concurrent_bench ../workloads/cut-$F-$2-$1.bin $T 32
-    ./concurrent_bench ../workloads/cut-$F-$3-$1.bin $T 32
-  done;
+  ./concurrent_bench sweep ../workloads/cut-$F-$2-$1.bin $TS $KS > ../logs/sweep-cut-$F-$2-$1.csv
+  ./concurrent_bench sweep ../workloads/cut-$F-$3-$1.bin $TS $KS > ../logs/sweep-cut-$F-$3-$1.csv
 done;